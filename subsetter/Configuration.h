@@ -10,8 +10,10 @@
 #include <boost/foreach.hpp>
 #include <boost/unordered_map.hpp>
 #include <algorithm>
+#include <bitset>
 #include <exception>
 #include <map>
+#include <set>
 #include <vector>
 #include <string.h>
 #include <stdlib.h>
@@ -73,6 +75,22 @@ public:
                 }
             }
 
+            // get the granule extent sources for each shortname pattern
+            if (root.get_child_optional("ExtentSources"))
+            {
+                BOOST_FOREACH(property_tree::ptree::value_type &nodei, root.get_child("ExtentSources"))
+                {
+                    std::string shortNamePattern = nodei.first;
+                    std::map<std::string, std::string> sources;
+                    // path of each extent (west, east, south, north, start, end)
+                    BOOST_FOREACH(property_tree::ptree::value_type &nodej, nodei.second)
+                    {
+                        sources.insert(make_pair(nodej.first, nodej.second.get_value<std::string>()));
+                    }
+                    extentSources.insert(make_pair(shortNamePattern, sources));
+                }
+            }
+
             // get subsettable group patterns
             if (root.get_child_optional("SubsettableGroups"))
             {
@@ -235,6 +253,8 @@ public:
                     projections.insert(make_pair(v.first, v.second.data()));
                 }
             }
+
+            compilePatterns();
         }
         catch (std::exception &ex)
         {
@@ -277,6 +297,10 @@ public:
      */
     void setFreeboardSwathSegment(bool exist)
     {
+        if (exist != freeboardSwathSegment)
+        {
+            clearResolvedNames();
+        }
         freeboardSwathSegment = exist;
     }
 
@@ -308,7 +332,7 @@ public:
 
         for (std::map<std::string, std::string>::iterator it = missions.begin(); it != missions.end(); it++)
         {
-            if (regex_match(shortname, boost::regex(it->first)))
+            if (isShortNameMatched(shortname, it->first))
             {
                 mission = it->second;
                 break;
@@ -331,7 +355,7 @@ public:
         for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = superCoordinateDatasets.begin();
                 it != superCoordinateDatasets.end(); it++)
         {
-            if (regex_match(shortname, boost::regex(it->first)))
+            if (isShortNameMatched(shortname, it->first))
             {
                 datasets = it->second;
                 break;
@@ -351,7 +375,7 @@ public:
         for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = superGroups.begin();
                 it != superGroups.end(); it++)
         {
-            if (regex_match(shortname, boost::regex(it->first)))
+            if (isShortNameMatched(shortname, it->first))
             {
                 std::string pathDelim("/");
                 std::vector<std::string> paths;
@@ -414,11 +438,11 @@ public:
         for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = requiredDatasets.begin();
                 it != requiredDatasets.end(); it++)
         {
-            if (regex_match(format, boost::regex(it->first)))
+            if (regex_match(format, getRegex(it->first)))
             {
                 for (std::map<std::string, std::vector<std::string>>::iterator map_it = it->second.begin(); map_it != it->second.end(); map_it++)
                 {
-                    if(regex_match(groupname, boost::regex(map_it->first)))
+                    if(regex_match(groupname, getRegex(map_it->first)))
                     {
                         datasets = map_it->second;
                         getResolution(groupname, shortname, resolution);
@@ -445,11 +469,11 @@ public:
     {
         for(std::map<std::string, std::map<std::string, std::string>>::iterator it = resolutions.begin(); it != resolutions.end(); it++)
         {
-            if (regex_match(groupname, boost::regex(it->first)))
+            if (regex_match(groupname, getRegex(it->first)))
             {
                 for(std::map<std::string, std::string>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
                 {
-                    if(regex_match(shortname, boost::regex(it2->first)))
+                    if(isShortNameMatched(shortname, it2->first))
                     {
                        resolution = boost::lexical_cast<short>(it2->second);
                        break;
@@ -470,7 +494,7 @@ public:
 
         for(std::map<std::string, std::string>::iterator it = projections.begin(); it != projections.end(); it++)
         {
-            if (regex_match(groupname, boost::regex(it->first)))
+            if (regex_match(groupname, getRegex(it->first)))
             {
                 projection = it->second;
                 break;
@@ -504,8 +528,8 @@ public:
              it != subsettableGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::vector<std::string> groupPatterns = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::vector<std::string>& groupPatterns = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 shortNameMatched = true;
                 patternMatched = matchRegexpList(groupPatterns, group);
@@ -524,8 +548,8 @@ public:
              it != unsubsettableGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::vector<std::string> groupPatterns = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::vector<std::string>& groupPatterns = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (matchRegexpList(groupPatterns, group)) isSubsettable = false;
                 break;
@@ -547,7 +571,7 @@ public:
         std::string value;
         for (std::map<std::string, std::string>::iterator it = productEpochs.begin(); it != productEpochs.end(); it++)
         {
-            if (regex_match(shortName, boost::regex(it->first)))
+            if (isShortNameMatched(shortName, it->first))
             {
                 value = it->second;
                 break;
@@ -556,6 +580,28 @@ public:
         return value;
     }
 
+    /**
+     * get the configured sources of the extent a granule records in its metadata
+     * @param shortName product shortname
+     * @return map of extent ("west", "east", "south", "north", "start", "end")
+     *         to the path of the attribute or scalar dataset holding it,
+     *         empty if no configuration found
+     */
+    std::map<std::string, std::string> getExtentSources(const std::string& shortName)
+    {
+        std::map<std::string, std::string> sources;
+        for (std::map<std::string, std::map<std::string, std::string>>::iterator it = extentSources.begin();
+             it != extentSources.end(); it++)
+        {
+            if (isShortNameMatched(shortName, it->first))
+            {
+                sources = it->second;
+                break;
+            }
+        }
+        return sources;
+    }
+
     /**
      * matching the coordinate dataset names with configured ones
      * @param shortName product shortname
@@ -572,8 +618,8 @@ public:
              it != coordinateDatasetNames.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::vector<std::string>> coordinates = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::vector<std::string>>& coordinates = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 // time dataset
                 if (coordinates.find("time") != coordinates.end())
@@ -685,7 +731,7 @@ public:
         {
             std::string shortNamePattern = it->first;
             // shortname matched
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 matched = true;
                 break;
@@ -706,13 +752,13 @@ public:
                 it != superGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 for (std::map<std::string, std::vector<std::string>>::iterator it2 = it->second.begin();
                         it2 != it->second.end(); it2++)
                 {
                     std::string groupPattern = it2->first;
-                    if (regex_match(groupname, boost::regex(groupPattern)))
+                    if (regex_match(groupname, getRegex(groupPattern)))
                     {
                         matched = true;
                         break;
@@ -728,10 +774,11 @@ public:
      * @param shortName product shortname
      * @param group group name
      * @param patternName pattern name
+     * @param anchored whether the pattern must match the end of the group name
      * @return true or false
      */
     bool isGroupPatternMatched(const std::string& shortName, const std::string& group,
-                             const std::string patternName)
+                             const std::string patternName, bool anchored = false)
     {
         bool matched = false;
         // check shortname and group match
@@ -739,14 +786,15 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
+            const std::map<std::string, std::string>& keyinfo = it->second;
             // shortname matched
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find(patternName.c_str()) != keyinfo.end())
                 {
                     std::string groupPattern = keyinfo.at(patternName.c_str());
-                    if (regex_search(group, boost::regex(groupPattern)))
+                    if (anchored) groupPattern += "$";
+                    if (regex_search(group, getRegex(groupPattern)))
                     {
                         matched = true;
                         break;
@@ -766,8 +814,7 @@ public:
      */
     bool isSegmentGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("SegmentGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, SEGMENT_GROUP);
     }
 
     /**
@@ -778,8 +825,7 @@ public:
      */
     bool isPhotonGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("PhotonGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, PHOTON_GROUP);
     }
 
      /**
@@ -790,8 +836,7 @@ public:
      */
     bool isPhotonDataset(const std::string& shortName, const std::string& dataset)
     {
-        const std::string patternName("PhotonDataset");
-        return isGroupPatternMatched(shortName, dataset, patternName);
+        return hasPathRole(shortName, dataset, PHOTON_DATASET);
     }
 
     /**
@@ -802,28 +847,7 @@ public:
      */
     bool isFreeboardSwathSegmentGroup(const std::string& shortName, const std::string& group)
     {
-        bool matched = false;
-        // check shortname and group match
-        for (std::map<std::string, std::map<std::string,std::string>>::iterator it = photonSegmentGroups.begin();
-             it != photonSegmentGroups.end(); it++)
-        {
-            std::string shortNamePattern = it->first;
-            std::map<std::string,std::string> keyinfo = it->second;
-            // shortname matched
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
-            {
-                if (keyinfo.find("FreeboardSwathSegmentGroup") != keyinfo.end())
-                {
-                    std::string groupPattern = keyinfo.at("FreeboardSwathSegmentGroup")+"$";
-                    if (regex_search(group, boost::regex(groupPattern)))
-                    {
-                        matched = true;
-                        break;
-                    }
-                }
-            }
-        }
-        return matched;
+        return hasPathRole(shortName, group, FREEBOARD_SWATH_SEGMENT_GROUP);
     }
 
     /**
@@ -834,8 +858,7 @@ public:
      */
     bool isFreeboardBeamSegmentGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("FreeboardBeamSegmentGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, FREEBOARD_BEAM_SEGMENT_GROUP);
     }
 
     /**
@@ -846,8 +869,7 @@ public:
      */
     bool isFreeboardSegmentGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("FreeboardSegmentGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, FREEBOARD_SEGMENT_GROUP);
     }
 
     /**
@@ -858,8 +880,7 @@ public:
      */
     bool isLeadsGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("LeadsGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, LEADS_GROUP);
     }
 
     /**
@@ -870,8 +891,7 @@ public:
      */
     bool isReferenceSurfaceSectionGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("ReferenceSurfaceSectionGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, REFERENCE_SURFACE_SECTION_GROUP);
     }
 
     /**
@@ -882,8 +902,7 @@ public:
      */
     bool isSwathFreeboardGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("SwathFreeboardGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, SWATH_FREEBOARD_GROUP);
     }
 
     /**
@@ -894,8 +913,7 @@ public:
      */
     bool isBeamFreeboardGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("BeamFreeboardGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, BEAM_FREEBOARD_GROUP);
     }
 
     /**
@@ -906,8 +924,7 @@ public:
      */
     bool isHeightsGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("HeightsGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, HEIGHTS_GROUP);
     }
 
     /**
@@ -918,8 +935,7 @@ public:
      */
     bool isGeophysicalGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("GeophysicalGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, GEOPHYSICAL_GROUP);
     }
 
     /**
@@ -930,8 +946,7 @@ public:
      */
     bool isFreeboardSegmentHeightsGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("FreeboardSegmentHeightsGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, FREEBOARD_SEGMENT_HEIGHTS_GROUP);
     }
 
     /**
@@ -942,8 +957,7 @@ public:
      */
     bool isFreeboardSegmentGeophysicalGroup(const std::string& shortName, const std::string& group)
     {
-        const std::string patternName("FreeboardSegmentGeophysicalGroup");
-        return isGroupPatternMatched(shortName, group, patternName);
+        return hasPathRole(shortName, group, FREEBOARD_SEGMENT_GEOPHYSICAL_GROUP);
     }
 
     /**
@@ -954,8 +968,7 @@ public:
      */
     bool isBeamIndex(const std::string& shortName, const std::string datasetName)
     {
-        const std::string patternName("BeamIndex");
-        return isGroupPatternMatched(shortName, datasetName, patternName);
+        return hasPathRole(shortName, datasetName, BEAM_INDEX);
     }
 
     /*
@@ -998,12 +1011,29 @@ public:
     }
 
     /**
-     * get corresponding referenced group for a given group
+     * get corresponding referenced group for a given group, resolved once per group
      * @param shortName product shortname
      * @param group group name
      * @return string corresponding segment group or empty string
      */
     std::string getReferencedGroupname(const std::string& shortName, const std::string& group)
+    {
+        PathClassification& path = getPathClassification(shortName, group);
+        if (!path.referencedGroupnameResolved)
+        {
+            path.referencedGroupname = resolveReferencedGroupname(shortName, group);
+            path.referencedGroupnameResolved = true;
+        }
+        return path.referencedGroupname;
+    }
+
+    /**
+     * get corresponding referenced group for a given group
+     * @param shortName product shortname
+     * @param group group name
+     * @return string corresponding segment group or empty string
+     */
+    std::string resolveReferencedGroupname(const std::string& shortName, const std::string& group)
     {
         LOG_DEBUG("Configuration::getReferencedGroupname() ENTER group:" << group);
 
@@ -1074,12 +1104,30 @@ public:
     }
 
     /**
-     * get target group for a given group
+     * get target group for a given group, resolved once per group and dataset
      * @param shortName product shortname
      * @param group group name
+     * @param datasetName dataset name
      * @return string corresponding segment group or empty string
      */
     std::string getTargetGroupname(const std::string& shortName, const std::string& group, const std::string& datasetName = "")
+    {
+        PathClassification& path = getPathClassification(shortName, group);
+        std::map<std::string, std::string>::iterator it = path.targetGroupnames.find(datasetName);
+        if (it == path.targetGroupnames.end())
+        {
+            it = path.targetGroupnames.insert(make_pair(datasetName, resolveTargetGroupname(shortName, group, datasetName))).first;
+        }
+        return it->second;
+    }
+
+    /**
+     * get target group for a given group
+     * @param shortName product shortname
+     * @param group group name
+     * @return string corresponding segment group or empty string
+     */
+    std::string resolveTargetGroupname(const std::string& shortName, const std::string& group, const std::string& datasetName = "")
     {
         LOG_DEBUG("Configuration::getTargetGroupname(): ENTER group:" << group);
 
@@ -1158,9 +1206,9 @@ public:
             it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
+                const std::map<std::string, std::string>& keyinfo = it->second;
                 // shortname matched
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     // get the photon and segment group names which are at the end of path pattern
                     std::string pathDelim("/");
@@ -1196,9 +1244,9 @@ public:
             it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
+                const std::map<std::string, std::string>& keyinfo = it->second;
                 // shortname matched
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     // get the photon and segment group names which are at the end of path pattern
                     std::string pathDelim("/");
@@ -1234,9 +1282,9 @@ public:
                     it!= photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
+                const std::map<std::string, std::string>& keyinfo = it->second;
                 //shortname matched
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     std::string pathDelim("/");
                     std::vector<std::string> paths;
@@ -1268,8 +1316,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("FreeboardSwathSegmentGroup") != keyinfo.end() )
                 {
@@ -1302,8 +1350,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     freeboardBeamSegmentGroup = keyinfo.at("FreeboardBeamSegmentGroup");
                     split(paths, group, boost::is_any_of(pathDelim));
@@ -1339,8 +1387,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     beamFreeboardGroup = keyinfo.at("BeamFreeboardGroup");
                     split(paths, group, boost::is_any_of(pathDelim));
@@ -1378,8 +1426,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     freeboardSegmentGroup = keyinfo.at("FreeboardSegmentGroup");
                     split(paths, group, boost::is_any_of(pathDelim));
@@ -1412,8 +1460,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 std::string pathDelim("/");
                 std::vector<std::string> paths;
@@ -1465,8 +1513,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     referenceSurfaceSectionGroup = keyinfo.at("ReferenceSurfaceSectionGroup");
                     split(paths, group, boost::is_any_of(pathDelim));
@@ -1505,8 +1553,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     heightsGroupname = keyinfo.at("HeightsGroup");
                     split(paths, heightsGroupname, boost::is_any_of(pathDelim));
@@ -1541,8 +1589,8 @@ public:
                  it != photonSegmentGroups.end(); it++)
             {
                 std::string shortNamePattern = it->first;
-                std::map<std::string, std::string> keyinfo = it->second;
-                if (regex_match(shortName, boost::regex(shortNamePattern)))
+                const std::map<std::string, std::string>& keyinfo = it->second;
+                if (isShortNameMatched(shortName, shortNamePattern))
                 {
                     heightsGroupname = keyinfo.at("FreeboardSegmentHeightsGroup");
                     split(paths, heightsGroupname, boost::is_any_of(pathDelim));
@@ -1619,12 +1667,32 @@ public:
         boost::replace_last(count, pattern, sub);
     }
 
+    /**
+     * get configured index begin dataset name, resolved once per group and dataset
+     * @param shortName product shortname
+     * @param groupname group name
+     * @param datasetName dataset name
+     * @param repair whether the index begin dataset is being repaired
+     * @return index begin dataset name
+     */
+    std::string getIndexBeginDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="", bool repair = false)
+    {
+        PathClassification& path = getPathClassification(shortName, groupname);
+        std::map<std::pair<std::string, bool>, std::string>::iterator it = path.indexBeginDatasetNames.find(make_pair(datasetName, repair));
+        if (it == path.indexBeginDatasetNames.end())
+        {
+            it = path.indexBeginDatasetNames.insert(make_pair(make_pair(datasetName, repair),
+                resolveIndexBeginDatasetName(shortName, groupname, datasetName, repair))).first;
+        }
+        return it->second;
+    }
+
     /**
      * get configured segment photonIndexBegin dataset name
      * @param shortName product shortname
      * @return photonIndexBegin dataset name
      */
-    std::string getIndexBeginDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="", bool repair = false)
+    std::string resolveIndexBeginDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="", bool repair = false)
     {
         LOG_DEBUG("Configuration::getIndexBeginDatasetName(): ENTER groupname: " << groupname);
 
@@ -1668,12 +1736,30 @@ public:
         return indexBegin;
     }
 
+    /**
+     * get configured count dataset name, resolved once per group and dataset
+     * @param shortName product shortname
+     * @param groupname group name
+     * @param datasetName dataset name
+     * @return count dataset name
+     */
+    std::string getCountDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="")
+    {
+        PathClassification& path = getPathClassification(shortName, groupname);
+        std::map<std::string, std::string>::iterator it = path.countDatasetNames.find(datasetName);
+        if (it == path.countDatasetNames.end())
+        {
+            it = path.countDatasetNames.insert(make_pair(datasetName, resolveCountDatasetName(shortName, groupname, datasetName))).first;
+        }
+        return it->second;
+    }
+
     /**
      * get configured segment segmentPhotonCount dataset name
      * @param shortName product shortname
      * @return segmentPhotonCount dataset name
      */
-    std::string getCountDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="")
+    std::string resolveCountDatasetName(const std::string& shortName, const std::string& groupname, const std::string& datasetName="")
     {
         LOG_DEBUG("Configuration::getCountDatasetName(): ENTER groupname: " << groupname);
 
@@ -1717,9 +1803,9 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string,std::string> keyinfo = it->second;
+            const std::map<std::string, std::string>& keyinfo = it->second;
             // shortname matched
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("PhotonIndexBegin") != keyinfo.end() && keyinfo.find("SegmentPhotonCount") != keyinfo.end())
                 {
@@ -1743,8 +1829,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("LeadsIndex") != keyinfo.end() && keyinfo.find("LeadsCount") != keyinfo.end())
                 {
@@ -1774,8 +1860,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("SwathIndex") != keyinfo.end() && keyinfo.find("SwathCount") != keyinfo.end())
                 {
@@ -1830,8 +1916,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("BeamIndex") != keyinfo.end() && keyinfo.find("BeamCount") != keyinfo.end())
                 {
@@ -1857,8 +1943,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("BeamFreeboardIndex") != keyinfo.end())
                 {
@@ -1883,8 +1969,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("SwathHeightIndex") != keyinfo.end())
                 {
@@ -1907,8 +1993,8 @@ public:
              it != photonSegmentGroups.end(); it++)
         {
             std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
+            const std::map<std::string, std::string>& keyinfo = it->second;
+            if (isShortNameMatched(shortName, shortNamePattern))
             {
                 if (keyinfo.find("SwathHeightIndex") != keyinfo.end())
                 {
@@ -1927,28 +2013,7 @@ public:
      */
     bool isSwathHeightIndex(const std::string& shortName, const std::string datasetName)
     {
-        bool matched = false;
-
-        for (std::map<std::string, std::map<std::string, std::string>>::iterator it = photonSegmentGroups.begin();
-             it != photonSegmentGroups.end(); it++)
-        {
-            std::string shortNamePattern = it->first;
-            std::map<std::string, std::string> keyinfo = it->second;
-            if (regex_match(shortName, boost::regex(shortNamePattern)))
-            {
-                if (keyinfo.find("SwathHeightIndex") != keyinfo.end())
-                {
-                    std::string datasetPattern = keyinfo.at("SwathHeightIndex");
-                    if (regex_search(datasetName, boost::regex(datasetPattern)))
-                    {
-                        matched = true;
-                        break;
-                    }
-                }
-            }
-        }
-
-        return matched;
+        return hasPathRole(shortName, datasetName, SWATH_HEIGHT_INDEX);
     }
 
     /**
@@ -1958,7 +2023,23 @@ public:
      */
     void addShortNameGroupDatasetFromGranuleFile(const std::string& shortName, const std::string& group)
     {
+        if (!granuleFileEntries.insert(std::make_pair(shortName, group)).second)
+        {
+            return;
+        }
         shortNameGroupDatasetFromGranuleFile[shortName].push_back(group);
+
+        // the resolved group names depend on the granule version, which the
+        // first version specific group determines
+        if (versionNumbers.find(shortName) == versionNumbers.end() && group.find("/freeboard_") != std::string::npos)
+        {
+            std::string versionNumber = getGroupVersionNumber(group);
+            if (!versionNumber.empty())
+            {
+                versionNumbers[shortName] = versionNumber;
+                clearResolvedNames();
+            }
+        }
     }
 
     /**
@@ -1971,22 +2052,11 @@ public:
     {
         LOG_DEBUG("Configuration::isShortNameGroupDatasetFromGranuleFile(): ENTER group: " << group);
 
-        bool patternMatched = false;
-        std::string shortNamePattern("");
-
-        for (const auto& keyinfo : shortNameGroupDatasetFromGranuleFile)
+        bool patternMatched = (granuleFileEntries.find(std::make_pair(shortName, group)) != granuleFileEntries.end());
+        if (patternMatched)
         {
-            shortNamePattern = keyinfo.first;
-            for (const auto& valueinfo : keyinfo.second)
-            {
-                if(shortNamePattern == shortName && valueinfo == group)
-                {
-                    LOG_DEBUG("Configuration::isShortNameGroupDatasetFromGranuleFile() FOUND  shortName: "
-                          << shortNamePattern << " group: " << valueinfo);
-                    patternMatched = true;
-                    break;
-                }
-            }
+            LOG_DEBUG("Configuration::isShortNameGroupDatasetFromGranuleFile() FOUND  shortName: "
+                  << shortName << " group: " << group);
         }
 
         return patternMatched;
@@ -2001,24 +2071,27 @@ public:
     {
         LOG_DEBUG("Configuration::getVersionNumber(): ENTER shortName: " << shortName);
 
-        const std::string atl10v005("/gt[\\w]+/freeboard_beam_segment/");
-        const std::string atl10v006("/gt[\\w]+/freeboard_segment/");
+        std::map<std::string, std::string>::iterator version = versionNumbers.find(shortName);
+        if (version != versionNumbers.end())
+        {
+            return version->second;
+        }
 
         for (const auto& keyinfo : shortNameGroupDatasetFromGranuleFile)
         {
             for (const auto& valueinfo : keyinfo.second)
             {
-                if(keyinfo.first == shortName && regex_match(valueinfo, boost::regex(atl10v005)))
+                std::string versionNumber;
+                if (keyinfo.first == shortName)
                 {
-                    LOG_DEBUG("Configuration::getVersionNumber() FOUND version = 005 shortName: "
-                              << keyinfo.first << " group: " << valueinfo);
-                    return ATL10v005;
+                    versionNumber = getGroupVersionNumber(valueinfo);
                 }
-                else if(keyinfo.first == shortName && regex_match(valueinfo, boost::regex(atl10v006)))
+                if (!versionNumber.empty())
                 {
-                    LOG_DEBUG("Configuration::getVersionNumber() FOUND version = 006 shortName: "
+                    LOG_DEBUG("Configuration::getVersionNumber() FOUND version = " << versionNumber << " shortName: "
                               << keyinfo.first << " group: " << valueinfo);
-                    return ATL10v006;
+                    versionNumbers[shortName] = versionNumber;
+                    return versionNumber;
                 }
             }
         }
@@ -2032,6 +2105,254 @@ public:
 
 private:
 
+    // roles of a group or dataset path, one per PhotonSegmentGroups pattern
+    enum PathRole
+    {
+        SEGMENT_GROUP,
+        PHOTON_GROUP,
+        PHOTON_DATASET,
+        FREEBOARD_SWATH_SEGMENT_GROUP,
+        FREEBOARD_BEAM_SEGMENT_GROUP,
+        FREEBOARD_SEGMENT_GROUP,
+        LEADS_GROUP,
+        REFERENCE_SURFACE_SECTION_GROUP,
+        SWATH_FREEBOARD_GROUP,
+        BEAM_FREEBOARD_GROUP,
+        HEIGHTS_GROUP,
+        GEOPHYSICAL_GROUP,
+        FREEBOARD_SEGMENT_HEIGHTS_GROUP,
+        FREEBOARD_SEGMENT_GEOPHYSICAL_GROUP,
+        BEAM_INDEX,
+        SWATH_HEIGHT_INDEX,
+        PATH_ROLE_COUNT
+    };
+
+    /**
+     * classification of a group or dataset path of a product
+     * roles: the roles of the path, valid where the classified bit is set
+     * the resolved names depend on the granule version and the freeboard
+     * swath segment flag, and are cleared when either changes
+     */
+    struct PathClassification
+    {
+        std::bitset<PATH_ROLE_COUNT> classified;
+        std::bitset<PATH_ROLE_COUNT> roles;
+        bool referencedGroupnameResolved = false;
+        std::string referencedGroupname;
+        // key: dataset name
+        std::map<std::string, std::string> targetGroupnames;
+        std::map<std::string, std::string> countDatasetNames;
+        // key: dataset name and repair flag
+        std::map<std::pair<std::string, bool>, std::string> indexBeginDatasetNames;
+    };
+
+    /**
+     * get the classification of a path, adding it to the path table on first use
+     * @param shortName product shortname
+     * @param path group or dataset name
+     * @return the classification of the path
+     */
+    PathClassification& getPathClassification(const std::string& shortName, const std::string& path)
+    {
+        return pathTable[make_pair(shortName, path)];
+    }
+
+    /**
+     * check if a path has a role, matching the role's pattern only the first time
+     * @param shortName product shortname
+     * @param path group or dataset name
+     * @param role the role
+     * @return whether the path has the role
+     */
+    bool hasPathRole(const std::string& shortName, const std::string& path, PathRole role)
+    {
+        static const char* const patternNames[PATH_ROLE_COUNT] =
+        {
+            "SegmentGroup", "PhotonGroup", "PhotonDataset", "FreeboardSwathSegmentGroup",
+            "FreeboardBeamSegmentGroup", "FreeboardSegmentGroup", "LeadsGroup", "ReferenceSurfaceSectionGroup",
+            "SwathFreeboardGroup", "BeamFreeboardGroup", "HeightsGroup", "GeophysicalGroup",
+            "FreeboardSegmentHeightsGroup", "FreeboardSegmentGeophysicalGroup", "BeamIndex", "SwathHeightIndex"
+        };
+
+        PathClassification& classification = getPathClassification(shortName, path);
+        if (!classification.classified.test(role))
+        {
+            classification.roles.set(role, isGroupPatternMatched(shortName, path, patternNames[role],
+                                                                 role == FREEBOARD_SWATH_SEGMENT_GROUP));
+            classification.classified.set(role);
+        }
+        return classification.roles.test(role);
+    }
+
+    /**
+     * get the version number a version specific group identifies
+     * @param group group from the granule file
+     * @return shortname/version number string (Ex. ATL10v005), or empty string
+     */
+    std::string getGroupVersionNumber(const std::string& group)
+    {
+        const std::string atl10v005("/gt[\\w]+/freeboard_beam_segment/");
+        const std::string atl10v006("/gt[\\w]+/freeboard_segment/");
+
+        if (regex_match(group, getRegex(atl10v005)))
+        {
+            return ATL10v005;
+        }
+        else if (regex_match(group, getRegex(atl10v006)))
+        {
+            return ATL10v006;
+        }
+        return std::string();
+    }
+
+    // clear the resolved names of every path, keeping their roles
+    void clearResolvedNames()
+    {
+        for (std::map<std::pair<std::string, std::string>, PathClassification>::iterator it = pathTable.begin();
+             it != pathTable.end(); it++)
+        {
+            it->second.referencedGroupnameResolved = false;
+            it->second.referencedGroupname.clear();
+            it->second.targetGroupnames.clear();
+            it->second.countDatasetNames.clear();
+            it->second.indexBeginDatasetNames.clear();
+        }
+    }
+
+    /**
+     * compile the configured patterns once, so the predicates never build a
+     * regular expression while a granule is subsetted
+     */
+    void compilePatterns()
+    {
+        for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = coordinateDatasetNames.begin();
+             it != coordinateDatasetNames.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::string>::iterator it = productEpochs.begin(); it != productEpochs.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::string>::iterator it = missions.begin(); it != missions.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::map<std::string, std::string>>::iterator it = extentSources.begin();
+             it != extentSources.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::map<std::string, std::string>>::iterator it = photonSegmentGroups.begin();
+             it != photonSegmentGroups.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = superCoordinateDatasets.begin();
+             it != superCoordinateDatasets.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+        }
+        for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = superGroups.begin();
+             it != superGroups.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+            for (std::map<std::string, std::vector<std::string>>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+            {
+                getRegex(it2->first);
+            }
+        }
+        for (std::map<std::string, std::vector<std::string>>::iterator it = subsettableGroups.begin();
+             it != subsettableGroups.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+            for (std::vector<std::string>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+            {
+                getRegex(*it2);
+            }
+        }
+        for (std::map<std::string, std::vector<std::string>>::iterator it = unsubsettableGroups.begin();
+             it != unsubsettableGroups.end(); it++)
+        {
+            shortNamePatterns.push_back(it->first);
+            for (std::vector<std::string>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+            {
+                getRegex(*it2);
+            }
+        }
+        for (std::map<std::string, std::map<std::string, std::string>>::iterator it = resolutions.begin(); it != resolutions.end(); it++)
+        {
+            getRegex(it->first);
+            for (std::map<std::string, std::string>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+            {
+                shortNamePatterns.push_back(it2->first);
+            }
+        }
+        for (std::map<std::string, std::map<std::string, std::vector<std::string>>>::iterator it = requiredDatasets.begin();
+             it != requiredDatasets.end(); it++)
+        {
+            getRegex(it->first);
+            for (std::map<std::string, std::vector<std::string>>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+            {
+                getRegex(it2->first);
+            }
+        }
+        for (std::map<std::string, std::string>::iterator it = projections.begin(); it != projections.end(); it++)
+        {
+            getRegex(it->first);
+        }
+
+        std::sort(shortNamePatterns.begin(), shortNamePatterns.end());
+        shortNamePatterns.erase(std::unique(shortNamePatterns.begin(), shortNamePatterns.end()), shortNamePatterns.end());
+        for (std::vector<std::string>::iterator it = shortNamePatterns.begin(); it != shortNamePatterns.end(); it++)
+        {
+            getRegex(*it);
+        }
+    }
+
+    /**
+     * get the compiled regular expression of a pattern, compiling it on first use
+     * @param pattern the pattern
+     * @return the compiled regular expression
+     */
+    const boost::regex& getRegex(const std::string& pattern)
+    {
+        std::map<std::string, boost::regex>::iterator it = regexes.find(pattern);
+        if (it == regexes.end())
+        {
+            it = regexes.insert(make_pair(pattern, boost::regex(pattern))).first;
+        }
+        return it->second;
+    }
+
+    /**
+     * check if a shortname matches a configured shortname pattern
+     * The product profile of a shortname, i.e. which configured shortname
+     * patterns it matches, is resolved the first time the shortname is seen.
+     * @param shortName product shortname
+     * @param shortNamePattern shortname pattern
+     * @return whether the shortname matches the pattern
+     */
+    bool isShortNameMatched(const std::string& shortName, const std::string& shortNamePattern)
+    {
+        std::map<std::string, std::map<std::string, bool>>::iterator profile = productProfiles.find(shortName);
+        if (profile == productProfiles.end())
+        {
+            profile = productProfiles.insert(make_pair(shortName, std::map<std::string, bool>())).first;
+            for (std::vector<std::string>::iterator it = shortNamePatterns.begin(); it != shortNamePatterns.end(); it++)
+            {
+                profile->second[*it] = regex_match(shortName, getRegex(*it));
+            }
+        }
+
+        std::map<std::string, bool>::iterator matched = profile->second.find(shortNamePattern);
+        if (matched == profile->second.end())
+        {
+            matched = profile->second.insert(make_pair(shortNamePattern, regex_match(shortName, getRegex(shortNamePattern)))).first;
+        }
+        return matched->second;
+    }
+
     // return a value in vectorB which is also in vectorA,
     // an empty string is returned if no matches
     std::string findStringInBothVectors(std::vector<std::string> vectorA, std::vector<std::string> vectorB)
@@ -2053,12 +2374,12 @@ private:
     // check if a given string matches any regexp on the list, only search if the string
     // has the pattern since the string can have extra information
     // e.g. value: /profile_1/calibration matches the regexpList which has /profile_1
-    bool matchRegexpList(std::vector<std::string> regexpList, std::string value)
+    bool matchRegexpList(const std::vector<std::string>& regexpList, const std::string& value)
     {
         bool matchFound = false;
-        for (std::vector<std::string>::iterator it = regexpList.begin(); it != regexpList.end(); it++)
+        for (std::vector<std::string>::const_iterator it = regexpList.begin(); it != regexpList.end(); it++)
         {
-            if (regex_search(value, boost::regex(*it)))
+            if (regex_search(value, getRegex(*it)))
             {
                 matchFound = true;
                 break;
@@ -2090,6 +2411,15 @@ private:
      */
     std::map<std::string, std::string> productEpochs;
 
+    /**
+     * key: shortname pattern, value: map of extent to the path of the
+     * attribute or scalar dataset recording it in the granule
+     * e.g.
+     * "ATL[\\d]{2}": { "west": "/METADATA/Extent/westBoundLongitude",
+     *                  "start": "/METADATA/Extent/rangeBeginningDateTime", ... }
+     */
+    std::map<std::string, std::map<std::string, std::string>> extentSources;
+
     /**
      * subsettable groups
      * key: shortname pattern
@@ -2151,7 +2481,7 @@ private:
 
     std::map<std::string, std::string> projections;
 
-    bool freeboardSwathSegment;
+    bool freeboardSwathSegment = false;
 
     /**
      * Cache of shortname, group, and dataset from granule file
@@ -2160,6 +2490,40 @@ private:
      */
     std::map<std::string, std::vector<std::string>> shortNameGroupDatasetFromGranuleFile;
 
+    // the cached <shortname, group or dataset> pairs, so each is cached once
+    std::set<std::pair<std::string, std::string>> granuleFileEntries;
+
+    /**
+     * compiled regular expressions
+     * key: pattern
+     * value: compiled regular expression
+     */
+    std::map<std::string, boost::regex> regexes;
+
+    // every configured shortname pattern
+    std::vector<std::string> shortNamePatterns;
+
+    /**
+     * product profiles
+     * key: shortname
+     * value: map of shortname pattern and whether the shortname matches it
+     */
+    std::map<std::string, std::map<std::string, bool>> productProfiles;
+
+    /**
+     * path table
+     * key: shortname and group or dataset name
+     * value: classification of the path
+     */
+    std::map<std::pair<std::string, std::string>, PathClassification> pathTable;
+
+    /**
+     * granule versions found in the granule file cache
+     * key: shortname
+     * value: shortname/version number string (Ex. ATL10v005)
+     */
+    std::map<std::string, std::string> versionNumbers;
+
     const std::string ATL10v005 = "ATL10v005";
     const std::string ATL10v006 = "ATL10v006";
 
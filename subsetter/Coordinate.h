@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <functional>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
@@ -16,10 +17,12 @@
 #include "H5Cpp.h"
 #include "IndexSelection.h"
 #include "geobox.h"
+#include "GeoGrid.h"
 #include "Temporal.h"
 #include "SubsetDataLayers.h"
 #include "GeoPolygon.h"
 #include "Configuration.h"
+#include "H5Catalog.h"
 #include "LogLevel.h"
 
 
@@ -88,22 +91,44 @@ public:
 
         // loop through all datasets in a group
         // to get coordinate datasets from coordinate attributes
-        for (i = 0; i < numOfObjs; i++)
+        if (catalog != NULL)
         {
-            ingroup.getObjTypeByIdx(i, typeName);
-            objName = ingroup.getObjnameByIdx(i);
-            bool inSubsetDataLayers = subsetDataLayers->is_included(groupname+objName+"/");
-
-            if (typeName == "dataset")
+            std::string ingroupname = ingroup.getObjName();
+            const std::vector<H5Catalog::Entry>& objects = catalog->getChildren(ingroupname);
+            for (std::vector<H5Catalog::Entry>::const_iterator it = objects.begin(); it != objects.end(); it++)
             {
-                H5::DataSet data = ingroup.openDataSet(objName);
-                H5::DataSpace inspace = data.getSpace();
-                int dim = inspace.getSimpleExtentNdims();
-                hsize_t olddims[dim];
-                inspace.getSimpleExtentDims(olddims);
-                arraySize = olddims[0];
-                allDatasets.push_back(objName);
-                coor->getCoordinateDatasetNames(data, shortname, latitudeName, longitudeName, timeName, ignoreName, coorGroupname);
+                if (it->type == "dataset")
+                {
+                    const H5Catalog::Entry* data = catalog->getDataset(ingroupname, it->name);
+                    arraySize = data->dims.empty()? 0 : data->dims[0];
+                    allDatasets.push_back(it->name);
+                    if (data->hasCoordinates)
+                    {
+                        coor->addCoordinateDatasetNames(data->coordinates, shortname, latitudeName, longitudeName, timeName,
+                                                        ignoreName, coorGroupname);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (i = 0; i < numOfObjs; i++)
+            {
+                ingroup.getObjTypeByIdx(i, typeName);
+                objName = ingroup.getObjnameByIdx(i);
+                bool inSubsetDataLayers = subsetDataLayers->is_included(groupname+objName+"/");
+
+                if (typeName == "dataset")
+                {
+                    H5::DataSet data = ingroup.openDataSet(objName);
+                    H5::DataSpace inspace = data.getSpace();
+                    int dim = inspace.getSimpleExtentNdims();
+                    hsize_t olddims[dim];
+                    inspace.getSimpleExtentDims(olddims);
+                    arraySize = olddims[0];
+                    allDatasets.push_back(objName);
+                    coor->getCoordinateDatasetNames(data, shortname, latitudeName, longitudeName, timeName, ignoreName, coorGroupname);
+                }
             }
         }
         // match datasets in the group with the coordinate dataset names in the configuration file
@@ -233,6 +258,45 @@ public:
         else return true;
     }
 
+    // forget the Coordinate instances of a previous subset of the granule, so the
+    // next subset (e.g. of another region) computes its own index selections
+    // the instances are not freed, as their IndexSelection objects may be shared
+    static void resetLookUp()
+    {
+        lookUpMap.clear();
+    }
+
+    // keep the coordinate values read from the granule, so subsets of several
+    // regions of the same granule read and decompress each coordinate once
+    static void shareCoordinateValues(bool share)
+    {
+        sharingCoordinateValues = share;
+        if (!share) coordinateValues.clear();
+    }
+
+    // query the catalog of the input granule instead of walking its groups,
+    // or walk the groups again when the catalog is NULL
+    static void setCatalog(H5Catalog* inputCatalog)
+    {
+        catalog = inputCatalog;
+    }
+
+    // set the catalog while an instance is in scope, and reset it when the
+    // scope is left, also when a subset throws, so it never outlives the catalog
+    class CatalogScope
+    {
+    public:
+        CatalogScope(H5Catalog* inputCatalog)
+        {
+            Coordinate::setCatalog(inputCatalog);
+        }
+
+        ~CatalogScope()
+        {
+            Coordinate::setCatalog(NULL);
+        }
+    };
+
     /**
      * read lat/lon values from DataSet object to array
      * @param latSet latitude DataSet
@@ -244,29 +308,39 @@ public:
     {
         LOG_DEBUG("Coordinate::readLatLonDatasets(): ENTER");
 
-        if (latSet->getDataType().getSize() == 8) // double
-        {
-            latSet->read(lat, latSet->getDataType());
-        }
-        else
+        readCoordinateValues(latSet, lat);
+        readCoordinateValues(lonSet, lon);
+    }
+
+    /**
+     * read coordinate values from DataSet object to array, from the shared
+     * coordinate values if they were already read
+     * @param set coordinate DataSet
+     * @param values coordinate array
+     */
+    void readCoordinateValues(H5::DataSet* set, double* values)
+    {
+        std::string name = set->getObjName();
+        if (sharingCoordinateValues && coordinateValues.count(name) && coordinateValues[name].size() == coordinateSize)
         {
-            float* data = new float[coordinateSize];
-            latSet->read(data, latSet->getDataType());
-            for (int i = 0; i < coordinateSize; i++) lat[i] = data[i];
-            delete [] data;
+            LOG_DEBUG("Coordinate::readCoordinateValues(): " << name << " already read");
+            std::copy(coordinateValues[name].begin(), coordinateValues[name].end(), values);
+            return;
         }
 
-        if (lonSet->getDataType().getSize() == 8) //double
+        if (set->getDataType().getSize() == 8) // double
         {
-            lonSet->read(lon, lonSet->getDataType());
+            set->read(values, set->getDataType());
         }
         else
         {
             float* data = new float[coordinateSize];
-            lonSet->read(data, lonSet->getDataType());
-            for (int i = 0; i < coordinateSize; i++) lon[i] = data[i];
+            set->read(data, set->getDataType());
+            for (int i = 0; i < coordinateSize; i++) values[i] = data[i];
             delete [] data;
         }
+
+        if (sharingCoordinateValues) coordinateValues[name].assign(values, values + coordinateSize);
     }
 
     // return IndexSelection instance, if it exists
@@ -299,20 +373,27 @@ public:
         if (temporal != NULL && timeSet != NULL)
         {
             updateEpochTime(timeSet);
-            timeSet->read(time, timeSet->getDataType());
+            readCoordinateValues(timeSet, time);
             temporalSubset(time);
         }
         else LOG_DEBUG("Coordinate::getIndexSelection(): temporal constraint or temporal coordinate not found");
 
         // read lat/lon datasets if spatial(bbox/polygon) constraints exist
-        if ((geoboxes != NULL || geoPolygon != NULL) && (latSet != NULL && lonSet !=NULL)) readLatLonDatasets(latSet, lonSet, lat, lon);
+        if ((geoboxes != NULL || geoPolygon != NULL) && (latSet != NULL && lonSet !=NULL))
+        {
+            readLatLonDatasets(latSet, lonSet, lat, lon);
+
+            // the points within the temporal constraint are classified in a
+            // mask shared by the bbox and polygon passes
+            std::vector<unsigned char> mask;
+            setValidMask(lat, lon, mask);
 
-        // limit the index by spatial constraint
-        if (geoboxes != NULL && latSet != NULL && lonSet !=NULL) spatialBboxSubset(lat, lon);
-        else LOG_DEBUG("Coordinate::getIndexSelection(): spatial constraint or lat/lon coordinates not found");
-        // limit the index by polygon
-        if (geoPolygon != NULL && latSet != NULL && lonSet != NULL) spatialPolygonSubset(lat, lon);
-        else LOG_DEBUG("Coordinate::getIndexSelection(): polygon or lat/lon coordinates not found");
+            // limit the index by polygon, which replaces the bbox selection,
+            // or else by spatial constraint
+            if (geoPolygon != NULL) spatialPolygonSubset(lat, lon, mask);
+            else spatialBboxSubset(lat, lon, mask);
+        }
+        else LOG_DEBUG("Coordinate::getIndexSelection(): spatial constraint, polygon or lat/lon coordinates not found");
 
         indexesProcessed = true;
 
@@ -376,6 +457,23 @@ protected:
         std::string objName, typeName;
         hsize_t arraySize = 0;
 
+        if (catalog != NULL)
+        {
+            std::string ingroupname = group.getObjName();
+            const std::vector<H5Catalog::Entry>& objects = catalog->getChildren(ingroupname);
+            // only the datasets up to the first non-empty one need describing
+            for (std::vector<H5Catalog::Entry>::const_iterator it = objects.begin();
+                 it != objects.end() && coordinateSize == 0; it++)
+            {
+                if (it->type == "dataset")
+                {
+                    const H5Catalog::Entry* data = catalog->getDataset(ingroupname, it->name);
+                    coordinateSize = data->dims.empty()? 0 : data->dims[0];
+                }
+            }
+            return;
+        }
+
         for (int i = 0; i < group.getNumObjs(); i++)
         {
             objName = group.getObjnameByIdx(i);
@@ -451,9 +549,10 @@ protected:
             if (attrName == "units")
             {
                 attr.read(attr.getDataType(), attrValue);
+                static const boost::regex datePattern("\\d{4}[-]\\d{2}[-]\\d{2}");
                 boost::smatch match;
                 // parse out date from the units attribute if exists
-                if (regex_search(attrValue, match, boost::regex("\\d{4}[-]\\d{2}[-]\\d{2}")))
+                if (regex_search(attrValue, match, datePattern))
                 {
                     epoch = match[0] + timeStr;
                     // if the epoch is different from the product epoch in configuration file or default epoch,
@@ -479,48 +578,40 @@ protected:
         if ((coordinateSize != olddims[0]) && (!inconsistentCoorDatasets)) inconsistentCoorDatasets = true;
     }
 
-private:
-
-    // limit the index range by spatial constraints
-    // lat/lon datasets for SMAP are 32-bit floating-point and 64-bit for ICESat
-    void spatialBboxSubset(double* lat, double* lon)
+    // the bits of the spatial mask, one byte per point within the temporal constraint
+    enum SpatialMaskBits
     {
-        LOG_DEBUG("Coordinate::spatialBboxSubset(): ENTER");
+        VALID_POINT = 1,    // not a fill value
+        IN_BBOX = 2,        // within a bounding box
+        IN_ENVELOPE = 4,    // within the bounding box of the polygon
+        IN_POLYGON = 8      // within the polygon
+    };
 
-        long indexBegin = indexes->minIndexStart, indexEnd = indexes->maxIndexEnd - 1;
+    // add the index ranges of the points with a bit of the mask set
+    // the points with fill values extend an index range, a valid point
+    // without the bit ends it
+    void addMaskSegments(const std::vector<unsigned char>& mask, unsigned char bit)
+    {
+        long indexBegin = indexes->minIndexStart;
         long start = 0, length = 0;
-        for (int i=indexBegin; i<=indexEnd; i++)
-        {
-            std::vector<geobox>::iterator geobox_it = geoboxes->begin();
 
+        for (size_t k = 0; k < mask.size(); k++)
+        {
             // count in the points with fill values
-            if (lat[i] > 90 || lat[i] < -90 || lon[i] > 180 || lon[i] < -180)
+            if (!(mask[k] & VALID_POINT))
             {
-
                 if (length != 0) length++;
             }
-            // check if every point is within the spatial constraint
-            else
+            else if (mask[k] & bit)
             {
-                for (; geobox_it != geoboxes->end(); geobox_it++)
-                {
-                    if (geobox_it->contains(lat[i], lon[i]))
-                    {
-                        // new index range found
-                        if (length == 0) start = i;
-                        length++;
-                        break;
-                    }
-                }
-                // not covered by the bbox
-                if (geobox_it == geoboxes->end())
-                {
-                    if (length != 0)
-                    {
-                        indexes->addSegment(start, length);
-                        length = 0;
-                    }
-                }
+                // new index range found
+                if (length == 0) start = indexBegin + k;
+                length++;
+            }
+            else if (length != 0)
+            {
+                indexes->addSegment(start, length);
+                length = 0;
             }
         }
 
@@ -530,66 +621,202 @@ private:
         if (indexes->segments.empty()) indexes->addRestriction(0, 0);
     }
 
-    // limit the index range by polygon
-    void spatialPolygonSubset(double* lat, double* lon)
+private:
+
+    // mark the points that are not fill values
+    void setValidMask(double* lat, double* lon, std::vector<unsigned char>& mask)
     {
-        LOG_DEBUG("Coordinate::spatialPolygonSubset(): ENTER");
+        long indexBegin = indexes->minIndexStart, indexEnd = indexes->maxIndexEnd - 1;
+        mask.assign(std::max(indexEnd - indexBegin + 1, 0L), 0);
+        for (long i = indexBegin; i <= indexEnd; i++)
+        {
+            if (!(lat[i] > 90 || lat[i] < -90 || lon[i] > 180 || lon[i] < -180)) mask[i - indexBegin] = VALID_POINT;
+        }
+    }
 
-        IndexSelection* newIndexes = new IndexSelection(coordinateSize);
+    // limit the index range by spatial constraints
+    // lat/lon datasets for SMAP are 32-bit floating-point and 64-bit for ICESat
+    void spatialBboxSubset(double* lat, double* lon, std::vector<unsigned char>& mask)
+    {
+        LOG_DEBUG("Coordinate::spatialBboxSubset(): ENTER");
 
-        geobox g = geoPolygon->getBbox();
-        if (geoboxes == NULL) geoboxes = new std::vector<geobox>();
-        geoboxes->push_back(g);
+        markBboxPoints(lat, lon, *geoboxes, IN_BBOX, mask);
+        addMaskSegments(mask, IN_BBOX);
+    }
 
-        spatialBboxSubset(lat, lon);
-        LOG_DEBUG("Coordinate::spatialPolygonSubset(): indexes->size(): " << indexes->size());
+    // set a bit of the mask for the valid points within any of the bounding boxes
+    void markBboxPoints(double* lat, double* lon, std::vector<geobox>& boxes, unsigned char bit,
+                        std::vector<unsigned char>& mask)
+    {
+        long indexBegin = indexes->minIndexStart, indexEnd = indexes->maxIndexEnd - 1;
 
-        if (indexes->size() == 0) return;
+        // only the points within the latitude band of a bounding box are
+        // checked, the points skipped between them are outside every bounding box
+        std::vector<std::pair<long, long>> ranges;
+        findBboxLatitudeRanges(lat, mask, indexBegin, indexEnd, boxes, ranges);
 
-        long start = 0, length = 0;
+        // the bounding boxes each point is checked against
+        GeoGrid boxGrid = indexGeoboxes(boxes);
 
-        for (std::map<long, long>::iterator it = indexes->segments.begin(); it != indexes->segments.end(); it++)
+        for (std::vector<std::pair<long, long>>::iterator range = ranges.begin(); range != ranges.end(); range++)
         {
-            for (int i = it->first; i != it->second+it->first; i++)
+            for (long i = range->first; i <= range->second; i++)
             {
-                // count in the points with fill values
-                if (lat[i] > 90 || lat[i] < -90 || lon[i] > 180 || lon[i] < -180)
-                {
+                unsigned char& point = mask[i - indexBegin];
+                if (!(point & VALID_POINT)) continue;
 
-                    if (length != 0) length++;
-                }
-                // check if every point is within the polygon
-                else
+                const std::vector<int>& candidates = boxGrid.getCandidates(lat[i], lon[i]);
+                for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
                 {
-                    if (geoPolygon->contains(lat[i], lon[i]))
+                    if (boxes[*it].contains(lat[i], lon[i]))
                     {
-                        if(length == 0) start = i;
-                        length++;
-                    }
-                    else
-                    {
-                        if (length != 0)
-                        {
-                            newIndexes->addSegment(start, length);
-                            length = 0;
-                        }
+                        point |= bit;
+                        break;
                     }
                 }
             }
-            if (length != 0)
+        }
+    }
+
+    // index the bounding boxes by the longitudes and latitudes they may contain,
+    // a bounding box wrapping across the Anti-Meridian (or 180 degrees) is added
+    // with its extent shifted by 360 degrees to cover both sides
+    GeoGrid indexGeoboxes(std::vector<geobox>& boxes)
+    {
+        GeoGrid boxGrid(-180, -90, 180, 90, boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            geobox& box = boxes[i];
+            double south = box.getSouth(), north = box.getNorth();
+            if (!(south < north))
             {
-                newIndexes->addSegment(start, length);
-                length = 0;
+                south = -90;
+                north = 90;
             }
+            double west = box.getWest(), east = box.getEast();
+            if (!(west < east))
+            {
+                boxGrid.add(i, -180, south, 180, north);
+                continue;
+            }
+            boxGrid.add(i, west, south, east, north);
+            boxGrid.add(i, west + 360, south, east + 360, north);
+            boxGrid.add(i, west - 360, south, east - 360, north);
+        }
+        return boxGrid;
+    }
 
+    // find the index ranges (first, last) of the points markBboxPoints checks
+    // along a trajectory latitude only changes direction at the turning latitudes, so
+    // the points are split into runs of monotonic latitude in one pass, and the
+    // latitude band of each bounding box is binary searched within each run
+    // fill values and latitudes that are not numbers end a run, they are within
+    // no bounding box, and runs a bounding box wrapping across the latitude range
+    // can not be searched in are checked in full
+    void findBboxLatitudeRanges(double* lat, const std::vector<unsigned char>& mask, long indexBegin, long indexEnd,
+                                std::vector<geobox>& boxes, std::vector<std::pair<long, long>>& ranges)
+    {
+        long runStart = indexBegin;
+        int direction = 0;
+        for (long i = indexBegin; i <= indexEnd + 1; i++)
+        {
+            bool valid = (i <= indexEnd && (mask[i - indexBegin] & VALID_POINT) && lat[i] == lat[i]);
+            if (valid && i > runStart)
+            {
+                int step = (lat[i] > lat[i-1]) - (lat[i] < lat[i-1]);
+                if (direction == 0 || step == 0 || step == direction)
+                {
+                    if (direction == 0) direction = step;
+                    continue;
+                }
+            }
+            else if (valid)
+            {
+                continue;
+            }
+
+            // the run ends before this point
+            if (i > runStart) addBboxLatitudeRanges(lat, runStart, i - 1, direction, boxes, ranges);
+            runStart = valid ? i : i + 1;
+            direction = 0;
         }
+    }
 
-        // if new index range found, but does not have an end point, add it
-        if (length != 0) newIndexes->addSegment(start, length);
-        // if no index range found, return no data
-        if (newIndexes->segments.empty()) newIndexes->addRestriction(0, 0);
+    // add the index ranges of a monotonic latitude run within the latitude band
+    // of any bounding box, in index order
+    void addBboxLatitudeRanges(double* lat, long runStart, long runEnd, int direction,
+                               std::vector<geobox>& boxes, std::vector<std::pair<long, long>>& ranges)
+    {
+        std::vector<std::pair<long, long>> bands;
+        for (std::vector<geobox>::iterator it = boxes.begin(); it != boxes.end(); it++)
+        {
+            double south = it->getSouth(), north = it->getNorth();
+            double* first = lat + runStart;
+            double* last = lat + runEnd + 1;
+            double *bandFirst, *bandLast;
+            if (!(south < north))
+            {
+                bandFirst = first;
+                bandLast = last;
+            }
+            else if (direction >= 0)
+            {
+                bandFirst = std::lower_bound(first, last, south);
+                bandLast = std::upper_bound(bandFirst, last, north);
+            }
+            else
+            {
+                bandFirst = std::lower_bound(first, last, north, std::greater<double>());
+                bandLast = std::upper_bound(bandFirst, last, south, std::greater<double>());
+            }
+            if (bandFirst < bandLast) bands.push_back(std::make_pair(bandFirst - lat, bandLast - lat - 1));
+        }
+
+        // merge the overlapping bands of several bounding boxes
+        std::sort(bands.begin(), bands.end());
+        for (std::vector<std::pair<long, long>>::iterator it = bands.begin(); it != bands.end(); it++)
+        {
+            if (!ranges.empty() && ranges.back().first >= runStart && it->first <= ranges.back().second + 1)
+            {
+                ranges.back().second = std::max(ranges.back().second, it->second);
+            }
+            else
+            {
+                ranges.push_back(*it);
+            }
+        }
+    }
+
+    // limit the index range by polygon
+    // the exact polygon test is only made for the valid points within the
+    // bounding box of the polygon
+    void spatialPolygonSubset(double* lat, double* lon, std::vector<unsigned char>& mask)
+    {
+        LOG_DEBUG("Coordinate::spatialPolygonSubset(): ENTER");
 
-        indexes = newIndexes;
+        long indexBegin = indexes->minIndexStart;
+        std::vector<geobox> envelope(1, geoPolygon->getBbox());
+        markBboxPoints(lat, lon, envelope, IN_ENVELOPE, mask);
+
+        // follow the trajectory through each run of consecutive points within
+        // the bounding box, checking only the polygon edges crossed between them
+        PolygonTrack track(geoPolygon);
+        const unsigned char candidate = VALID_POINT | IN_ENVELOPE;
+        size_t previous = 0;
+        long candidates = 0;
+        for (size_t k = 0; k < mask.size(); k++)
+        {
+            if ((mask[k] & candidate) != candidate) continue;
+            if (candidates == 0 || k != previous + 1) track.reset();
+            previous = k;
+            candidates++;
+
+            long i = indexBegin + k;
+            if (track.contains(lat[i], lon[i])) mask[k] |= IN_POLYGON;
+        }
+        LOG_DEBUG("Coordinate::spatialPolygonSubset(): points within the polygon bounding box: " << candidates);
+
+        addMaskSegments(mask, IN_POLYGON);
     }
 
     // get coordinate dataset names from the "coordinates" attribute
@@ -599,8 +826,7 @@ private:
                                    std::string& ignoreName, std::string &coorGroupname)
     {
         H5::Attribute attr;
-        std::string attrName, attrValue, attrDataset, absPath;
-        boost::char_separator<char> delim(" ,");
+        std::string attrName, attrValue;
 
         // loop through all attributes for a dataset
         for (int i = 0; i < dataset.getNumAttrs(); i++)
@@ -612,49 +838,60 @@ private:
             if (attrName == "coordinates")
             {
                 attr.read(attr.getDataType(), attrValue);
-                boost::tokenizer<boost::char_separator<char> > datasets(attrValue, delim);
-                std::vector<std::string>::iterator it = datasetNames.begin();
-                BOOST_FOREACH(attrDataset, datasets)
-                {
-                    std::string dots = "..";
-                    // if it starts with '/', it is the absolute path
-                    if (attrDataset.find_first_of("/\\") == 0)
-                    {
-                        absPath = attrDataset;
-                    }
-                    // if the coordinate path does not have "..", the coordinate references
-                    // is in the same group
-                    else if (attrDataset.find(dots) == std::string::npos)
-                    {
-                        absPath = groupname + attrDataset;
-                    }
-                    // else, if it does contain "..", need to convert it to the correct path
-                    else
-                    {
-                        absPath = groupname+attrDataset;
-                        std::string pathDelim("/");
-                        std::vector<std::string> path;
-                        split(path, absPath, boost::is_any_of(pathDelim));
-                        std::vector<std::string>::iterator it = find(path.begin(), path.end(), dots);
-                        while (it != path.end())
-                        {
-                            path.erase(it-1, it+1);
-                            it = find(path.begin(), path.end(), dots);
-                        }
-                        absPath = boost::join(path, pathDelim);
-                    }
-                    attrDataset = attrDataset.substr(attrDataset.find_last_of("/\\")+1);
-                    coorGroupname = absPath.substr(0, absPath.find_last_of("/\\")+1);
-                    if (std::find(datasetNames.begin(),datasetNames.end(), attrDataset) == datasetNames.end())
-                    {
-                        LOG_DEBUG("Coordinate::getCoordinateDatasetNames(): adding " << attrDataset);
-                        datasetNames.push_back(attrDataset);
+                addCoordinateDatasetNames(attrValue, shortname, latitudeName, longitudeName, timeName, ignoreName, coorGroupname);
+            }
+        }
+    }
 
-                        // get matching coordinate dataset names with the configuration file
-                        config->getMatchingCoordinateDatasetNames(shortname, datasetNames, timeName, latitudeName, longitudeName,
-                                                                                        ignoreName);
-                    }
+    // parse the value of a dataset's "coordinates" attribute, and add the coordinate
+    // datasets it references that are not yet known
+    void addCoordinateDatasetNames(const std::string& attrValue, std::string shortname, std::string &latitudeName,
+                                   std::string &longitudeName, std::string &timeName, std::string& ignoreName,
+                                   std::string &coorGroupname)
+    {
+        std::string attrDataset, absPath;
+        boost::char_separator<char> delim(" ,");
+        boost::tokenizer<boost::char_separator<char> > datasets(attrValue, delim);
+        std::vector<std::string>::iterator it = datasetNames.begin();
+        BOOST_FOREACH(attrDataset, datasets)
+        {
+            std::string dots = "..";
+            // if it starts with '/', it is the absolute path
+            if (attrDataset.find_first_of("/\\") == 0)
+            {
+                absPath = attrDataset;
+            }
+            // if the coordinate path does not have "..", the coordinate references
+            // is in the same group
+            else if (attrDataset.find(dots) == std::string::npos)
+            {
+                absPath = groupname + attrDataset;
+            }
+            // else, if it does contain "..", need to convert it to the correct path
+            else
+            {
+                absPath = groupname+attrDataset;
+                std::string pathDelim("/");
+                std::vector<std::string> path;
+                split(path, absPath, boost::is_any_of(pathDelim));
+                std::vector<std::string>::iterator it = find(path.begin(), path.end(), dots);
+                while (it != path.end())
+                {
+                    path.erase(it-1, it+1);
+                    it = find(path.begin(), path.end(), dots);
                 }
+                absPath = boost::join(path, pathDelim);
+            }
+            attrDataset = attrDataset.substr(attrDataset.find_last_of("/\\")+1);
+            coorGroupname = absPath.substr(0, absPath.find_last_of("/\\")+1);
+            if (std::find(datasetNames.begin(),datasetNames.end(), attrDataset) == datasetNames.end())
+            {
+                LOG_DEBUG("Coordinate::getCoordinateDatasetNames(): adding " << attrDataset);
+                datasetNames.push_back(attrDataset);
+
+                // get matching coordinate dataset names with the configuration file
+                config->getMatchingCoordinateDatasetNames(shortname, datasetNames, timeName, latitudeName, longitudeName,
+                                                                                ignoreName);
             }
         }
     }
@@ -666,6 +903,17 @@ private:
 
     bool temporalOnlyCoordinates = false;
 
+    // coordinate values shared between the subsets of a granule,
+    // key: coordinate dataset path; value: coordinate values
+    static bool sharingCoordinateValues;
+    static std::map<std::string, std::vector<double> > coordinateValues;
+
+    // catalog of the input granule, NULL when the groups are walked directly
+    static H5Catalog* catalog;
+
 };
 boost::unordered_map<std::string, Coordinate*> Coordinate::lookUpMap;
+H5Catalog* Coordinate::catalog = NULL;
+bool Coordinate::sharingCoordinateValues = false;
+std::map<std::string, std::vector<double> > Coordinate::coordinateValues;
 #endif
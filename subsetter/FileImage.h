@@ -0,0 +1,122 @@
+#ifndef FILEIMAGE_H
+#define FILEIMAGE_H
+
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "H5Cpp.h"
+#include "hdf5_hl.h"
+
+#include "LogLevel.h"
+
+
+/**
+ * This class maps an input granule into memory and opens it as an HDF5
+ * file image, so the subsetter never reads the granule through the file
+ * system. The granule can be an open file descriptor (e.g. a memfd or a
+ * shared memory object handed over by the staging layer) or a path.
+ */
+class FileImage
+{
+public:
+
+    /**
+     * @brief Map the granule behind an open file descriptor.
+     *
+     * @param fd The file descriptor, which remains owned by the caller.
+     */
+    FileImage(int fd)
+    : image(MAP_FAILED), imageSize(0)
+    {
+        mapImage(fd, "file descriptor " + std::to_string(fd));
+    }
+
+    /**
+     * @brief Map the granule at a path.
+     *
+     * @param filename The granule file path.
+     */
+    FileImage(const std::string& filename)
+    : image(MAP_FAILED), imageSize(0)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("FileImage: unable to open " + filename + ": " + strerror(errno));
+        }
+        mapImage(fd, filename);
+        ::close(fd);
+    }
+
+    ~FileImage()
+    {
+        if (image != MAP_FAILED)
+        {
+            munmap(image, imageSize);
+        }
+    }
+
+    /**
+     * @brief Open the mapped granule as a read-only HDF5 file.
+     *
+     *        The library reads directly from the mapping, so this object
+     *        must outlive every handle to the returned file.
+     *
+     * @return The HDF5 file.
+     */
+    H5::H5File open()
+    {
+        LOG_DEBUG("FileImage::open(): opening " << imageSize << " byte file image");
+        hid_t fileId = H5LTopen_file_image(image, imageSize,
+                                           H5LT_FILE_IMAGE_DONT_COPY | H5LT_FILE_IMAGE_DONT_RELEASE);
+        if (fileId < 0)
+        {
+            throw H5::FileIException("FileImage::open", "H5LTopen_file_image failed");
+        }
+
+        // The H5File takes its own reference to the identifier.
+        H5::H5File file(fileId);
+        H5Idec_ref(fileId);
+        return file;
+    }
+
+    size_t getSize() { return imageSize; }
+
+private:
+
+    // the mapped granule
+    void* image;
+    size_t imageSize;
+
+    /**
+     * @brief Map the whole of an open file read-only.
+     *
+     * @param fd The file descriptor.
+     * @param description A description of the file for error messages.
+     */
+    void mapImage(int fd, const std::string& description)
+    {
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            throw std::runtime_error("FileImage: unable to read the size of " + description);
+        }
+
+        imageSize = fileStat.st_size;
+        image = mmap(NULL, imageSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (image == MAP_FAILED)
+        {
+            throw std::runtime_error("FileImage: unable to map " + description + ": " + strerror(errno));
+        }
+        LOG_INFO("FileImage: mapped " << imageSize << " bytes from " << description);
+    }
+
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include "SuperGroupCoordinate.h"
 #include "LogLevel.h"
 
+#include <algorithm>
+#include <vector>
 #include <boost/algorithm/string/find.hpp>
 
 /*
@@ -27,6 +29,38 @@ public:
     IndexSelection* segIndexes = nullptr;
     // Selected Segments - computed in SegmentedTrajectorySubset method
 
+    /*
+     * For each indexBeg index, the nearest non-fill index at or after it
+     * (with a final entry for the end of the array), and at or before it,
+     * built in one pass, so each segment boundary is found without rescanning
+     * fill runs. An index without a non-fill value after it maps to size,
+     * and without one before it, to -1.
+     */
+    struct NonFillTables
+    {
+        std::vector<long> next;
+        std::vector<long> prev;
+
+        NonFillTables(const int64_t indexBegDataset[], size_t size)
+        : next(size + 1), prev(size)
+        {
+            long nextIdx = size;
+            next[size] = nextIdx;
+            for (long i = (long)size - 1; i >= 0; i--)
+            {
+                if (indexBegDataset[i] > 0) nextIdx = i;
+                next[i] = nextIdx;
+            }
+
+            long prevIdx = -1;
+            for (size_t i = 0; i < size; i++)
+            {
+                if (indexBegDataset[i] > 0) prevIdx = i;
+                prev[i] = prevIdx;
+            }
+        }
+    };
+
     ForwardReferenceCoordinates   // main constructor for class
         (std::string groupname, std::vector<geobox>* geoboxes,
          Temporal* temporal,    GeoPolygon* geoPolygon,
@@ -154,6 +188,10 @@ public:
         // return null to include all in the output
         if (geoboxes == NULL && temporal == NULL && geoPolygon == NULL) { return NULL;}
 
+        // the selection is computed once, and reused by every dataset
+        // written with this coordinate
+        if (indexesProcessed) return indexes;
+
         H5::DataSet *indexBegSet = nullptr;
 
         indexes = new IndexSelection(coordinateSize);
@@ -200,11 +238,28 @@ public:
     *                        indexBeg value.
     * @param firstNonFillIdx The first non-fill indexBeg index.
     * @param indexBegDatset  The input indexBeg dataset array.
+    * @param nonFill         The non-fill tables of the indexBeg array, or
+    *                        NULL to scan the array.
     */
     void scanFwdNonFill( long segStartIdx, long segEndIdx,
                          long &firstTrajIndex, long &firstNonFillIdx,
-                         int64_t indexBegDataset[] )
+                         int64_t indexBegDataset[],
+                         const NonFillTables* nonFill = NULL )
     {
+        // look the next non-fill value up in the table
+        if (nonFill != NULL)
+        {
+            long lastIdx = std::min(segEndIdx, (long)nonFill->next.size() - 2);
+            if (segStartIdx < 0 || segStartIdx > lastIdx) return;
+            long i = nonFill->next[segStartIdx];
+            if (i <= lastIdx)
+            {
+                firstNonFillIdx = i;
+                firstTrajIndex = indexBegDataset[firstNonFillIdx];
+            }
+            return;
+        }
+
         // skip over segment-begin (start) fill values
         for (long i = segStartIdx; i <= segEndIdx; i++)
         {
@@ -226,11 +281,28 @@ public:
     *                        indexBeg value.
     * @param lastNonFillIdx  The last non-fill indexBeg index.
     * @param indexBegDatset  The input indexBeg dataset array.
+    * @param nonFill         The non-fill tables of the indexBeg array, or
+    *                        NULL to scan the array.
     */
     void scanBackNonFill( long segEndIdx, long segStartIdx,
                          long &lastTrajIndex, long &lastNonFillIdx,
-                         int64_t indexBegDataset[] )
+                         int64_t indexBegDataset[],
+                         const NonFillTables* nonFill = NULL )
     {
+        // look the previous non-fill value up in the table
+        if (nonFill != NULL)
+        {
+            long lastIdx = std::min(segEndIdx, (long)nonFill->prev.size() - 1);
+            if (lastIdx < 0 || lastIdx < segStartIdx) return;
+            long i = nonFill->prev[lastIdx];
+            if (i >= 0 && i >= segStartIdx)
+            {
+                lastNonFillIdx = i;
+                lastTrajIndex = indexBegDataset[lastNonFillIdx];
+            }
+            return;
+        }
+
         // skip over segment-begin (start) fill values
         for (long i = segEndIdx; i >= segStartIdx; i--)
         {
@@ -269,11 +341,14 @@ public:
      * @param maxTrajIndex     The final index of the entire trajectory
      *                         dataset.
      * @param indexBegDataset  The input indexBeg dataset array.
+     * @param nonFill          The non-fill tables of the indexBeg array, or
+     *                         NULL to scan the array.
      */
     void defineOneSegment( long selectedStartIdx, long selectedCount,
                            long &firstTrajIndex, long &trajSegLength,
                            long maxIndexBegIdx, long maxTrajIndex,
-                           int64_t indexBegDataset[] )
+                           int64_t indexBegDataset[],
+                           const NonFillTables* nonFill = NULL )
     {
         LOG_DEBUG(" ForwardReferenceCoordinates::defineOneSegment(): ENTER");
 
@@ -285,14 +360,14 @@ public:
 
         // Step forwards to find first non-fill index begin segment.
         scanFwdNonFill( selectedStartIdx, lastSelectedIdx,
-                        firstTrajIndex, firstIdxNonFill, indexBegDataset );
+                        firstTrajIndex, firstIdxNonFill, indexBegDataset, nonFill );
 
         // Step backwards to find last non-fill index begin segment.
         long lastTrajIndex = 0;  // trajectory index with the last non-fill
                                  // indexBeg value.
         long lastBegIdx = 0;     // last non-fill indexBeg index.
         scanBackNonFill( lastSelectedIdx, firstIdxNonFill,
-                         lastTrajIndex, lastBegIdx, indexBegDataset );
+                         lastTrajIndex, lastBegIdx, indexBegDataset, nonFill );
 
         // if not found - skip this selected segment group
         if (lastTrajIndex <= 0)
@@ -325,7 +400,7 @@ public:
                                  // selected segment.
 
         scanFwdNonFill( lastBegIdx+1, maxIndexBegIdx,
-                        nextTrajIndex, nextBegIdx, indexBegDataset );
+                        nextTrajIndex, nextBegIdx, indexBegDataset, nonFill );
 
         // We need to calculate the length of the last segment in the selection
         // since we can't use the count dataset.
@@ -388,6 +463,8 @@ private:
             }
             delete[] data;
         }
+            NonFillTables nonFill(indexBeg, idxBegSize);
+
             // Create Segment reference - start index and length
             // ** avoiding selected segment references that are fill values **
             //
@@ -407,7 +484,7 @@ private:
 
                 defineOneSegment(selectedStart, selectedCount,
                                 start, length, idxBegSize,
-                                coordinateSize, indexBeg);
+                                coordinateSize, indexBeg, &nonFill);
 
 
                 // Note: index-selection start is true to datasets,
@@ -430,7 +507,7 @@ private:
 
                 defineOneSegment( selectedStart, selectedCount,
                                 start, length, idxBegSize,
-                                coordinateSize, indexBeg );
+                                coordinateSize, indexBeg, &nonFill );
 
                // Note: index-selection start is true to datasets, zero based indexing, whereas
                 // start index pulled from indexBegin datasets is one based indexing
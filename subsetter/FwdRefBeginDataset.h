@@ -2,6 +2,9 @@
 #define FWDREFBEGINDATASET_H
 
 #include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
 #include "Configuration.h"
 #include "LogLevel.h"
 
@@ -48,41 +51,35 @@ public:
         size_t outputCoordinateSize
             = countOutDS.getSpace().getSimpleExtentNpoints();
 
-        // Read in the source and declare the output Segment Begin dataset.
-        hid_t segmentBegin_native_type
-            = H5Tget_native_type ( H5Dget_type( indataset.getId() ),
-                                   H5T_DIR_ASCEND );
-        size_t inputCoordinateSize
-            = indataset.getSpace().getSimpleExtentNpoints();
-        int64_t* subsetBeginIn
-            = new int64_t[inputCoordinateSize];
-        int64_t* subsetBeginOut
-            = new int64_t[outputCoordinateSize];
-
-        // Reading in the source data is data-type size specific:
-        if (H5Tequal(segmentBegin_native_type, H5T_NATIVE_INT)) // 32-bit int
-        {
-            indataset.read(subsetBeginIn, indataset.getDataType());
-        }
-        else if(H5Tequal(segmentBegin_native_type, H5T_NATIVE_USHORT)) // unsigned 16-bit int
-        {
-            uint16_t* data
-                = new uint16_t[inputCoordinateSize];
-            indataset.read(data, indataset.getDataType());
-            for (int i = 0; i < inputCoordinateSize; i++)
-                subsetBeginIn[i] = data[i];
-            delete[] data;
-        }
-        else   // 64-bit int
+        // For each selected element group, the rows of the segment begin
+        // dataset written to the output.
+        std::map<long, long> allSegments = selectedElements->getSegments();
+        std::vector<std::pair<long, long>> groups(allSegments.begin(), allSegments.end());
+        size_t selectedSize = 0;
+        for (size_t g = 0; g < groups.size(); g++)
+            selectedSize += groups[g].second;
+
+        // Read in only the selected source values, converted to 64-bit integers.
+        std::vector<int64_t> subsetBeginOut(std::max(outputCoordinateSize, selectedSize), 0);
+        if (selectedSize > 0)
         {
-            int64_t* data
-                = new int64_t[inputCoordinateSize];
-            indataset.read(data, indataset.getDataType());
-            for (int i = 0; i < inputCoordinateSize; i++)
-                subsetBeginIn[i] = data[i];
-            delete[] data;
+            H5::DataSpace inspace = indataset.getSpace();
+            inspace.selectNone();
+            for (size_t g = 0; g < groups.size(); g++)
+            {
+                hsize_t offset[1] = {(hsize_t)groups[g].first}, count[1] = {(hsize_t)groups[g].second};
+                inspace.selectHyperslab(H5S_SELECT_OR, count, offset);
+            }
+            hsize_t memdims[1] = {selectedSize};
+            H5::DataSpace memspace(1, memdims);
+            indataset.read(subsetBeginOut.data(), H5::PredType::NATIVE_INT64, memspace, inspace);
         }
 
+        // Read in the first row of each gap between the groups, where the
+        // target segment following a group's last non-fill value usually begins.
+        std::vector<int64_t> gapBeginIn;
+        readGapBegins(indataset, groups, gapBeginIn);
+
         // A few things to take into account when updating the Segment Begin values:
         // (1) Segment Count (size) datasets have _FillValue = 0
         // (2) Segment Begin datasets have _FillValue = 0 for ATL03 and ATL08,
@@ -100,76 +97,53 @@ public:
         // segment. Subtracting the offset yields zero for the output value, + 1 since
         // index values start at one.
 
+        // The offset only changes between selected element groups: the target
+        // values written for a group end where the next non-fill segment
+        // begins in the input, as ForwardReferenceCoordinates selects them
+        // (the count dataset does not include the padding of e.g. GEDI
+        // waveforms), and the values skipped up to the first non-fill segment
+        // of the next group are added to the offset. The offsets are thus a
+        // prefix sum over the groups, and within a group every non-fill value
+        // is shifted by the same offset.
         int64_t offset = 0;
 
-        // The start of the skipped values in the target (segmented) dataset.
+        // The begin value following the last non-fill segment written, in the input.
         int64_t nextSegmentBeginIn = 1;
 
-        // The end of the skipped values in the target (segmented) dataset.
-        int64_t skippedFillValueEnd = 1;
-        int64_t lstSegBegIndex = 0;
+        // The last group with a non-fill value, -1 before the first one.
+        long lastGroup = -1;
 
         // Forward Reference Segment Begin index to output dataset (starts at position 0).
-        int64_t segmentBeginOut = 0;
+        size_t segmentBeginOut = 0;
 
-        // For each selected element group, write to the segment begin output/subset dataset.
-        std::map<long, long> allSegments = selectedElements->getSegments();
-        for ( std::map<long, long>::iterator it = allSegments.begin();
-             it != allSegments.end();
-             it++ )
+        for (size_t g = 0; g < groups.size(); g++)
         {
+            int64_t* begin = subsetBeginOut.data() + segmentBeginOut;
+            size_t segmentCountIn = groups[g].second;
 
-            long segmentBeginIn = it->first;
-            long segmentCountIn = it->second;
-
-            // Prepare for offset update, stepping over fill values.
-            while (nextSegmentBeginIn <= 0
-                and lstSegBegIndex < segmentBeginIn + segmentCountIn) {
-                lstSegBegIndex++;
-                nextSegmentBeginIn = subsetBeginIn[lstSegBegIndex];
+            // Find the first and last non-fill values of the group.
+            size_t first = 0, last = segmentCountIn;
+            while (first < segmentCountIn && begin[first] <= 0) first++;
+            if (first == segmentCountIn)
+            {
+                segmentBeginOut += segmentCountIn;
+                continue;
             }
+            while (begin[last - 1] <= 0) last--;
 
-            // Find skipped segments end, stepping over fill values.
-            int skippedFillValueCnt = 0;
-            skippedFillValueEnd = subsetBeginIn[segmentBeginIn];
-            while (skippedFillValueEnd <= 0
-                   and skippedFillValueCnt < segmentCountIn - 1) {
-                subsetBeginOut[segmentBeginOut] = skippedFillValueEnd;
-                    // 0 for ATL3, ATL8, -1 for ATL10
-                skippedFillValueCnt++;
-                segmentBeginIn++;
-                segmentBeginOut++;
-                skippedFillValueEnd = subsetBeginIn[segmentBeginIn];
+            if (lastGroup >= 0)
+            {
+                nextSegmentBeginIn = findNextBeginIn(indataset, groups, gapBeginIn, lastGroup, g, begin[first]);
             }
+            offset = offset + begin[first] - nextSegmentBeginIn;
+            lastGroup = g;
 
-            // skippedFillValueEnd here defines the end of the skipped values from
-            // the previous iteration.
-            // Accumulating offset = offset + skipped-values-count
-            // skipped-values-count = skipped-end-point - skipped-start
-            // skipped-start      = (previous) nextSegmentBeginIn
-            if (nextSegmentBeginIn > 0 and skippedFillValueEnd > 0) {
-                offset = offset + skippedFillValueEnd - nextSegmentBeginIn;
-            }
+            // Shift the non-fill values, copying over the fill values
+            // (0 for ATL3, ATL8, -1 for ATL10), without branching.
+            for (size_t i = first; i < last; i++)
+                begin[i] = (begin[i] > 0) ? begin[i] - offset : begin[i];
 
-            // Calculate segment references for output segment begin dataset.
-            for (int i = skippedFillValueCnt; i < segmentCountIn; i++)
-            {
-                if (subsetBeginIn[segmentBeginIn] <= 0) {
-                    subsetBeginOut[segmentBeginOut]
-                        = subsetBeginIn[segmentBeginIn];
-                            // 0 for ATL3, ATL8, -1 for ATL10
-                } else {
-                    subsetBeginOut[segmentBeginOut]
-                        = subsetBeginIn[segmentBeginIn] - offset;
-
-                    // Prep to recalculate offset, in case this is the last
-                    // non-zero case in selected group.
-                    nextSegmentBeginIn = subsetBeginIn[segmentBeginIn + 1];
-                    lstSegBegIndex = segmentBeginIn;
-                }
-                segmentBeginIn++;
-                segmentBeginOut++;
-            }
+            segmentBeginOut += segmentCountIn;
         }
 
         // Write the index begin dataset.
@@ -183,14 +157,22 @@ public:
         for (int d = 1; d < dimnum; d++)
             newdims[d] = olddims[d];
 
+
+        // Contiguous datasets can't be extendible, so the subset dimensions
+        // are also the maximum dimensions.
+        H5::DSetCreatPropList plist = indataset.getCreatePlist();
+        if (plist.getLayout() == H5D_CONTIGUOUS)
+        {
+            for (int d = 0; d < dimnum; d++)
+                maxdims[d] = newdims[d];
+        }
+
         H5::DataSpace outspace(dimnum, newdims, maxdims);
         H5::DataType datatype(indataset.getDataType());
         H5::DataSet outdataset
             (outgroup.createDataSet
-                (datasetName, datatype, outspace, indataset.getCreatePlist()));
-        outdataset.write(subsetBeginOut, datatype, H5::DataSpace::ALL, outspace);
-        delete[] subsetBeginIn;
-        delete[] subsetBeginOut;
+                (datasetName, datatype, outspace, plist));
+        outdataset.write(subsetBeginOut.data(), H5::PredType::NATIVE_INT64, H5::DataSpace::ALL, outspace);
 
         // Unlink the count dataset if user doesn't ask for it.
         if (!subsetDataLayers->is_dataset_included(groupname + countName))
@@ -199,6 +181,90 @@ public:
         }
     }
 
+private:
+
+    // the most rows read at once while looking for a non-fill begin value in a gap
+    static const hsize_t MAX_GAP_BLOCK = 65536;
+
+    /**
+     * Read the first row of each gap between consecutive groups, in one read.
+     * @param indataset  DataSet - the input dataset
+     * @param groups     the selected groups, as (start, count) pairs
+     * @param gapBeginIn out: for each group, the begin value of the row
+     *                   following it if that row is not selected, else 0
+     */
+    static void readGapBegins(const H5::DataSet& indataset,
+        const std::vector<std::pair<long, long>>& groups,
+        std::vector<int64_t>& gapBeginIn)
+    {
+        gapBeginIn.assign(groups.size(), 0);
+        std::vector<hsize_t> rows;
+        for (size_t g = 0; g + 1 < groups.size(); g++)
+        {
+            long end = groups[g].first + groups[g].second;
+            if (end < groups[g + 1].first) rows.push_back(end);
+        }
+        if (rows.empty()) return;
+
+        std::vector<int64_t> values(rows.size());
+        H5::DataSpace inspace = indataset.getSpace();
+        inspace.selectElements(H5S_SELECT_SET, rows.size(), rows.data());
+        hsize_t memdims[1] = {rows.size()};
+        H5::DataSpace memspace(1, memdims);
+        indataset.read(values.data(), H5::PredType::NATIVE_INT64, memspace, inspace);
+
+        size_t row = 0;
+        for (size_t g = 0; g + 1 < groups.size(); g++)
+        {
+            if (groups[g].first + groups[g].second < groups[g + 1].first) gapBeginIn[g] = values[row++];
+        }
+    }
+
+    /**
+     * Find the begin value of the next non-fill segment following a group in
+     * the input, i.e. where the target values written for the group end.
+     * Only the gaps up to the next group with a non-fill value are searched,
+     * as the selected rows between them are fill values.
+     * @param indataset  DataSet - the input dataset
+     * @param groups     the selected groups, as (start, count) pairs
+     * @param gapBeginIn the first row of each gap, see readGapBegins
+     * @param lastGroup  the group whose following non-fill segment is found
+     * @param nextGroup  the next group with a non-fill value
+     * @param nextBegin  the first non-fill begin value of nextGroup
+     * @return the begin value of the next non-fill segment
+     */
+    static int64_t findNextBeginIn(const H5::DataSet& indataset,
+        const std::vector<std::pair<long, long>>& groups,
+        const std::vector<int64_t>& gapBeginIn,
+        size_t lastGroup, size_t nextGroup, int64_t nextBegin)
+    {
+        for (size_t g = lastGroup; g < nextGroup; g++)
+        {
+            hsize_t gapStart = groups[g].first + groups[g].second;
+            hsize_t gapEnd = groups[g + 1].first;
+            if (gapStart >= gapEnd) continue;
+            if (gapBeginIn[g] > 0) return gapBeginIn[g];
+
+            // The gap starts with fill values, read the rest of it in
+            // growing blocks until a non-fill value is found.
+            hsize_t block = 64;
+            for (hsize_t row = gapStart + 1; row < gapEnd; row += block, block = std::min(2 * block, (hsize_t)MAX_GAP_BLOCK))
+            {
+                hsize_t count[1] = {std::min(block, gapEnd - row)}, offset[1] = {row};
+                std::vector<int64_t> values(count[0]);
+                H5::DataSpace inspace = indataset.getSpace();
+                inspace.selectHyperslab(H5S_SELECT_SET, count, offset);
+                H5::DataSpace memspace(1, count);
+                indataset.read(values.data(), H5::PredType::NATIVE_INT64, memspace, inspace);
+                for (size_t i = 0; i < values.size(); i++)
+                {
+                    if (values[i] > 0) return values[i];
+                }
+            }
+        }
+        return nextBegin;
+    }
+
 };
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef GeoGrid_H
+#define GeoGrid_H
+//
+// GeoGrid is a uniform longitude/latitude grid over the extents of a set of
+// shapes (bounding boxes or polygon parts), so the shapes that may contain a
+// point are found from its grid cell rather than by testing every shape.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+class GeoGrid
+{
+    public:
+
+        // Initialization with the extent covered and the number of shapes to index
+        GeoGrid(double west, double south, double east, double north, size_t shapeCount) :
+                west(west),
+                south(south),
+                east(east),
+                north(north)
+        {
+            lonCells = std::min(std::max(4 * (size_t)std::ceil(std::sqrt((double)shapeCount)), (size_t)4), MAX_CELLS);
+            latCells = std::max(lonCells / 2, (size_t)2);
+            cellWidth = (east - west) / lonCells;
+            cellHeight = (north - south) / latCells;
+            cells.resize(lonCells * latCells);
+        };
+
+        // Add a shape by its extent, clamped to the grid. Shapes are added in
+        // increasing order, and a shape may be added with several extents.
+        void add(int shape, double shapeWest, double shapeSouth, double shapeEast, double shapeNorth)
+        {
+            shapeWest = std::max(shapeWest, west);
+            shapeEast = std::min(shapeEast, east);
+            shapeSouth = std::max(shapeSouth, south);
+            shapeNorth = std::min(shapeNorth, north);
+            if (!(shapeWest <= shapeEast && shapeSouth <= shapeNorth)) return;
+
+            size_t lonLast = getLonCell(shapeEast), latLast = getLatCell(shapeNorth);
+            for (size_t latCell = getLatCell(shapeSouth); latCell <= latLast; latCell++)
+            {
+                for (size_t lonCell = getLonCell(shapeWest); lonCell <= lonLast; lonCell++)
+                {
+                    std::vector<int>& cell = cells[latCell * lonCells + lonCell];
+                    if (cell.empty() || cell.back() != shape) cell.push_back(shape);
+                }
+            }
+        }
+
+        // The shapes, in the order added, whose extents overlap the grid cell
+        // of a point. Points outside the grid have no candidate shapes.
+        const std::vector<int>& getCandidates(double lat, double lon) const
+        {
+            if (!(lon >= west && lon <= east && lat >= south && lat <= north)) return noShapes;
+            return cells[getLatCell(lat) * lonCells + getLonCell(lon)];
+        }
+
+    private:
+
+        double west, south, east, north;
+        double cellWidth, cellHeight;
+        size_t lonCells, latCells;
+        std::vector<std::vector<int>> cells;
+        std::vector<int> noShapes;
+
+        // the most cells along the longitude axis
+        static constexpr size_t MAX_CELLS = 256;
+
+        size_t getLonCell(double lon) const
+        {
+            if (!(cellWidth > 0)) return 0;
+            return std::min((size_t)((lon - west) / cellWidth), lonCells - 1);
+        }
+
+        size_t getLatCell(double lat) const
+        {
+            if (!(cellHeight > 0)) return 0;
+            return std::min((size_t)((lat - south) / cellHeight), latCells - 1);
+        }
+};
+#endif
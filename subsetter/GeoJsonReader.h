@@ -0,0 +1,443 @@
+#ifndef GeoJsonReader_H
+#define GeoJsonReader_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/geometry.hpp>
+#include <boost/geometry/geometries/point_xy.hpp>
+#include <boost/geometry/geometries/polygon.hpp>
+#include <boost/geometry/multi/geometries/multi_polygon.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "LogLevel.h"
+
+typedef boost::geometry::model::d2::point_xy<double> point_type;
+typedef boost::geometry::model::polygon<point_type> polygon_type;
+typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
+
+
+/**
+ * Reads the polygons of a GeoJSON document in a single pass over its text,
+ * building the polygon rings directly rather than parsing the document into
+ * a boost::property_tree first.
+ *
+ * The polygons are found as GeoPolygon found them in the property tree:
+ * Polygon and MultiPolygon geometries, within FeatureCollection "features",
+ * Feature "geometry" and GeometryCollection "geometries", in document order.
+ * Members of an object may come in any order, so the geometries below an
+ * object are kept until its "type" is known.
+ *
+ * Malformed JSON throws a boost::property_tree::json_parser::json_parser_error,
+ * as boost::property_tree::read_json does.
+ */
+class GeoJsonReader
+{
+public:
+
+    GeoJsonReader(const std::string& text)
+    : position(text.data()), end(text.data() + text.size()), begin(text.data())
+    {
+    }
+
+    /**
+     * read the polygons of the document
+     * @param polygons the polygons found are appended to it
+     */
+    void read(multi_polygon_type& polygons)
+    {
+        skipSpace();
+        readValue(polygons);
+        skipSpace();
+        if (position != end) fail("garbage after data");
+    }
+
+private:
+
+    const char* position;
+    const char* end;
+    const char* begin;
+
+    // the positions of a "coordinates" array, and for every array of
+    // positions or of those arrays, its depth and the number of positions
+    // read when it ended
+    struct Coordinates
+    {
+        bool valid = true;
+        int positionDepth = -1;
+        std::vector<point_type> points;
+        std::vector<std::pair<int, size_t>> arrayEnds;
+    };
+
+    [[noreturn]] void fail(const std::string& message)
+    {
+        unsigned long line = 1 + std::count(begin, position, '\n');
+        throw boost::property_tree::json_parser::json_parser_error(message, "", line);
+    }
+
+    void skipSpace()
+    {
+        while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+        {
+            position++;
+        }
+    }
+
+    char peek()
+    {
+        skipSpace();
+        if (position == end) fail("unexpected end of data");
+        return *position;
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c) fail(std::string("expected '") + c + "'");
+        position++;
+    }
+
+    // true and consumes the character if it is next
+    bool accept(char c)
+    {
+        if (peek() != c) return false;
+        position++;
+        return true;
+    }
+
+    /**
+     * read any value, adding the polygons of an object to polygons
+     */
+    void readValue(multi_polygon_type& polygons)
+    {
+        if (peek() == '{') readObject(polygons);
+        else skipValue();
+    }
+
+    /**
+     * read the elements of an array, or the member values of an object, as
+     * the GeoJSON objects below a FeatureCollection or a GeometryCollection
+     */
+    void readMembers(multi_polygon_type& polygons)
+    {
+        char c = peek();
+        if (c != '[' && c != '{')
+        {
+            skipScalar();
+            return;
+        }
+        position++;
+        char close = (c == '[')? ']' : '}';
+        if (accept(close)) return;
+        do
+        {
+            if (close == '}')
+            {
+                readString();
+                expect(':');
+            }
+            peek() == '{'? readObject(polygons) : skipValue();
+        } while (accept(','));
+        expect(close);
+    }
+
+    /**
+     * read a GeoJSON object, adding the polygons of a Polygon or MultiPolygon,
+     * or of the objects below a collection or feature, to polygons
+     */
+    void readObject(multi_polygon_type& polygons)
+    {
+        std::string type;
+        bool hasType = false, hasCoordinates = false, hasFeatures = false, hasGeometry = false, hasGeometries = false;
+        Coordinates coordinates;
+        multi_polygon_type features, geometry, geometries;
+
+        expect('{');
+        if (!accept('}'))
+        {
+            do
+            {
+                std::string key = readString();
+                expect(':');
+                // the first of repeated members is used
+                if (key == "type" && !hasType)
+                {
+                    hasType = true;
+                    if (peek() == '"') type = readString();
+                    else skipValue();
+                }
+                else if (key == "coordinates" && !hasCoordinates)
+                {
+                    hasCoordinates = true;
+                    readCoordinates(coordinates, 0);
+                }
+                else if (key == "features" && !hasFeatures)
+                {
+                    hasFeatures = true;
+                    readMembers(features);
+                }
+                else if (key == "geometry" && !hasGeometry)
+                {
+                    hasGeometry = true;
+                    if (peek() == '{') readObject(geometry);
+                    else skipValue();
+                }
+                else if (key == "geometries" && !hasGeometries)
+                {
+                    hasGeometries = true;
+                    readMembers(geometries);
+                }
+                else
+                {
+                    skipValue();
+                }
+            } while (accept(','));
+            expect('}');
+        }
+
+        if ((type == "Polygon" || type == "MultiPolygon") && hasCoordinates)
+        {
+            addPolygons(coordinates, type == "MultiPolygon", polygons);
+        }
+        else if (type == "FeatureCollection")
+        {
+            appendPolygons(features, polygons);
+        }
+        else if (type == "Feature")
+        {
+            appendPolygons(geometry, polygons);
+        }
+        else if (type == "GeometryCollection")
+        {
+            appendPolygons(geometries, polygons);
+        }
+    }
+
+    static void appendPolygons(multi_polygon_type& from, multi_polygon_type& polygons)
+    {
+        if (polygons.empty())
+        {
+            polygons.swap(from);
+            return;
+        }
+        for (multi_polygon_type::iterator it = from.begin(); it != from.end(); it++)
+        {
+            polygons.push_back(polygon_type());
+            polygons.back().outer().swap(it->outer());
+            polygons.back().inners().swap(it->inners());
+        }
+    }
+
+    /**
+     * read a "coordinates" value, an array of positions or nested arrays of them
+     * @param coordinates the positions and array ends read
+     * @param depth the array depth of the value
+     */
+    void readCoordinates(Coordinates& coordinates, int depth)
+    {
+        if (peek() != '[')
+        {
+            coordinates.valid = false;
+            skipValue();
+            return;
+        }
+        position++;
+
+        char c = peek();
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            // a position, of which the longitude and latitude are used
+            std::vector<double> values;
+            do
+            {
+                if (peek() == '-' || (*position >= '0' && *position <= '9')) values.push_back(readNumber());
+                else
+                {
+                    coordinates.valid = false;
+                    skipValue();
+                }
+            } while (accept(','));
+            expect(']');
+
+            if (values.size() < 2 || (coordinates.positionDepth >= 0 && coordinates.positionDepth != depth))
+            {
+                coordinates.valid = false;
+                return;
+            }
+            coordinates.positionDepth = depth;
+            coordinates.points.push_back(point_type(values[0], values[1]));
+            return;
+        }
+
+        if (!accept(']'))
+        {
+            do
+            {
+                readCoordinates(coordinates, depth + 1);
+            } while (accept(','));
+            expect(']');
+        }
+        coordinates.arrayEnds.push_back(std::make_pair(depth, coordinates.points.size()));
+    }
+
+    /**
+     * add the polygons of Polygon or MultiPolygon coordinates
+     *
+     * A Polygon is an outer ring followed by inner rings. As GeoPolygon read
+     * a MultiPolygon, each of its rings is added as its own polygon, with the
+     * ring as the outer ring or at its position among the inner rings, and
+     * an empty polygon ends the MultiPolygon.
+     */
+    void addPolygons(const Coordinates& coordinates, bool isMultiPolygon, multi_polygon_type& polygons)
+    {
+        int ringDepth = isMultiPolygon? 2 : 1;
+        if (!coordinates.valid || (coordinates.positionDepth >= 0 && coordinates.positionDepth != ringDepth + 1))
+        {
+            fail(std::string("invalid ") + (isMultiPolygon? "MultiPolygon" : "Polygon") + " coordinates");
+        }
+
+        polygon_type polygon;
+        size_t ring = 0, ringBegin = 0;
+        for (std::vector<std::pair<int, size_t>>::const_iterator it = coordinates.arrayEnds.begin();
+             it != coordinates.arrayEnds.end(); it++)
+        {
+            if (it->first == ringDepth)
+            {
+                if (isMultiPolygon) polygon.clear();
+                polygon_type::ring_type* target = &polygon.outer();
+                if (ring > 0)
+                {
+                    polygon.inners().resize(ring);
+                    target = &polygon.inners()[ring-1];
+                }
+                target->assign(coordinates.points.begin() + ringBegin, coordinates.points.begin() + it->second);
+                if (isMultiPolygon) polygons.push_back(polygon);
+                ring++;
+                ringBegin = it->second;
+            }
+            else if (it->first == ringDepth - 1 && isMultiPolygon)
+            {
+                // the next polygon starts with its outer ring
+                ring = 0;
+            }
+        }
+        if (isMultiPolygon) polygon.clear();
+        polygons.push_back(polygon);
+    }
+
+    std::string readString()
+    {
+        expect('"');
+        std::string value;
+        while (position != end && *position != '"')
+        {
+            if ((unsigned char)*position < 0x20) fail("invalid code point");
+            if (*position == '\\')
+            {
+                position++;
+                if (position == end) break;
+                switch (*position)
+                {
+                    case '"': case '\\': case '/': value.push_back(*position); break;
+                    case 'b': value.push_back('\b'); break;
+                    case 'f': value.push_back('\f'); break;
+                    case 'n': value.push_back('\n'); break;
+                    case 'r': value.push_back('\r'); break;
+                    case 't': value.push_back('\t'); break;
+                    case 'u':
+                        // the names and types read are ASCII, other code points are kept escaped
+                        if (end - position < 5 || !isHex(position + 1)) fail("invalid escape sequence");
+                        value.append(position - 1, 6);
+                        position += 4;
+                        break;
+                    default: fail("invalid escape sequence");
+                }
+                position++;
+            }
+            else
+            {
+                value.push_back(*position++);
+            }
+        }
+        if (position == end) fail("unterminated string");
+        position++;
+        return value;
+    }
+
+    static bool isHex(const char* digits)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            char c = digits[i];
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) return false;
+        }
+        return true;
+    }
+
+    double readNumber()
+    {
+        const char* start = position;
+        if (position != end && *position == '-') position++;
+        const char* digits = position;
+        while (position != end && *position >= '0' && *position <= '9') position++;
+        if (position == digits || (*digits == '0' && position - digits > 1)) fail("invalid number");
+        if (position != end && *position == '.')
+        {
+            digits = ++position;
+            while (position != end && *position >= '0' && *position <= '9') position++;
+            if (position == digits) fail("invalid number");
+        }
+        if (position != end && (*position == 'e' || *position == 'E'))
+        {
+            position++;
+            if (position != end && (*position == '+' || *position == '-')) position++;
+            digits = position;
+            while (position != end && *position >= '0' && *position <= '9') position++;
+            if (position == digits) fail("invalid number");
+        }
+        return std::strtod(std::string(start, position).c_str(), NULL);
+    }
+
+    void skipScalar()
+    {
+        char c = peek();
+        if (c == '"') readString();
+        else if (c == '-' || (c >= '0' && c <= '9')) readNumber();
+        else if (!skipLiteral("true") && !skipLiteral("false") && !skipLiteral("null")) fail("expected value");
+    }
+
+    bool skipLiteral(const char* literal)
+    {
+        size_t length = std::char_traits<char>::length(literal);
+        if ((size_t)(end - position) < length || std::string(position, length) != literal) return false;
+        position += length;
+        return true;
+    }
+
+    // skip a value that holds no polygons, checking only its syntax
+    void skipValue()
+    {
+        char c = peek();
+        if (c != '{' && c != '[')
+        {
+            skipScalar();
+            return;
+        }
+        position++;
+        char close = (c == '[')? ']' : '}';
+        if (accept(close)) return;
+        do
+        {
+            if (close == '}')
+            {
+                readString();
+                expect(':');
+            }
+            skipValue();
+        } while (accept(','));
+        expect(close);
+    }
+
+};
+#endif
@@ -2,8 +2,14 @@
 #define GeoPolygon_H
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdint.h>
+#include <unistd.h>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/optional/optional.hpp>
@@ -16,13 +22,12 @@
 #include <boost/type_traits/is_empty.hpp>
 
 #include "geobox.h"
+#include "GeoGrid.h"
+#include "GeoJsonReader.h"
 #include "LogLevel.h"
 
 namespace property_tree = boost::property_tree;
 
-typedef boost::geometry::model::d2::point_xy<double> point_type;
-typedef boost::geometry::model::polygon<point_type> polygon_type;
-typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
 typedef boost::geometry::model::box<point_type> box_type;
 
 
@@ -35,11 +40,44 @@ public:
     bool crossedEast;
     bool crossedWest;
 
-    GeoPolygon(property_tree::ptree root):crossedEast(false),crossedWest(false)
+    GeoPolygon(const property_tree::ptree& root):crossedEast(false),crossedWest(false),partGrid(NULL)
     {
         readPolygon(root);
     };
 
+    /**
+     * read the polygons of a GeoJSON document
+     * @param geojson GeoJSON content
+     * @param cacheDirectory directory keeping the polygons read from each
+     *        document, so a document seen before is not read again,
+     *        or empty to always read the document
+     */
+    GeoPolygon(const std::string& geojson, const std::string& cacheDirectory = "")
+    : crossedEast(false),crossedWest(false),partGrid(NULL)
+    {
+        if (cacheDirectory.empty())
+        {
+            GeoJsonReader(geojson).read(polygons);
+            return;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.polygon", (unsigned long long)getHash(geojson));
+        std::string cachePath = cacheDirectory + "/" + name;
+        if (readCache(cachePath, geojson))
+        {
+            LOG_INFO("GeoPolygon::GeoPolygon(): read " << polygons.size() << " polygons from " << cachePath);
+            return;
+        }
+        GeoJsonReader(geojson).read(polygons);
+        writeCache(cachePath, geojson);
+    };
+
+    ~GeoPolygon()
+    {
+        delete partGrid;
+    }
+
      /**
      * get a minimal bounding box surrounding the polygon
      * @return geobox object
@@ -71,6 +109,40 @@ public:
      * @return true if the point is within the polygon, false otherwise
      */
     bool contains(double lat, double lon)
+    {
+        point_type property_tree(shiftLongitude(lon), lat);
+
+        // test only the polygons whose envelopes may contain the point, in
+        // order, and as for the multi-polygon, the first polygon the point is
+        // within or on the boundary of decides
+        if (polygons.size() > 1 && std::isfinite(property_tree.x()) && std::isfinite(property_tree.y()))
+        {
+            indexParts();
+            const std::vector<int>& candidates = partGrid->getCandidates(property_tree.y(), property_tree.x());
+            for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+            {
+                if (boost::geometry::within(property_tree, polygons[*it])) return true;
+                if (boost::geometry::covered_by(property_tree, polygons[*it])) return false;
+            }
+            return false;
+        }
+
+        if (boost::geometry::within(property_tree, polygons))
+        {
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /**
+     * shift a longitude to the side of the Anti-Meridian the polygon is on
+     * @param lon longitude
+     * @return the longitude in the range of the polygon vertices
+     */
+    double shiftLongitude(double lon)
     {
         // if the bbox crosses the Anti-Meridian at the East bound,
         // add 360 to negative longitude values
@@ -84,17 +156,7 @@ public:
         {
             lon = lon + -360;
         }
-
-        point_type property_tree(lon, lat);
-
-        if (boost::geometry::within(property_tree, polygons))
-        {
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+        return lon;
     }
 
     /**
@@ -111,6 +173,256 @@ public:
 
 private:
 
+    friend class PolygonTrack;
+
+    // an edge of a polygon ring, from (x1, y1) to (x2, y2) in longitude/latitude
+    struct Edge
+    {
+        double x1, y1, x2, y2;
+        double xmin, xmax, ymin, ymax;
+        int ring;
+    };
+
+    // the ring edges, and for each latitude band the edges overlapping it
+    std::vector<Edge> edges;
+    std::vector<std::vector<int>> edgeBands;
+    double edgeBandMin = 0, edgeBandHeight = 0;
+    bool edgesIndexed = false;
+
+    // for each ring, the polygon it belongs to, and for each polygon its first
+    // ring (the outer ring, followed by the inner rings)
+    std::vector<int> ringPolygon;
+    std::vector<int> polygonFirstRing;
+
+    // the polygons by the extent of their envelopes
+    GeoGrid* partGrid;
+
+    /**
+     * index the polygons of a multi-polygon by their envelopes
+     */
+    void indexParts()
+    {
+        if (partGrid != NULL) return;
+
+        std::vector<box_type> envelopes(polygons.size());
+        box_type extent;
+        boost::geometry::assign_inverse(extent);
+        for (size_t k = 0; k < polygons.size(); k++)
+        {
+            boost::geometry::envelope(polygons[k], envelopes[k]);
+            if (!polygons[k].outer().empty()) boost::geometry::expand(extent, envelopes[k]);
+        }
+
+        partGrid = new GeoGrid(extent.min_corner().x(), extent.min_corner().y(),
+                               extent.max_corner().x(), extent.max_corner().y(), polygons.size());
+        for (size_t k = 0; k < polygons.size(); k++)
+        {
+            if (polygons[k].outer().empty()) continue;
+            partGrid->add(k, envelopes[k].min_corner().x(), envelopes[k].min_corner().y(),
+                          envelopes[k].max_corner().x(), envelopes[k].max_corner().y());
+        }
+        LOG_DEBUG("GeoPolygon::indexParts(): indexed " << polygons.size() << " polygons");
+    }
+
+    /**
+     * index the ring edges by latitude band, so the edges near a point, or
+     * crossed by a step between two points, are found without visiting every
+     * edge of the polygons
+     */
+    void indexEdges()
+    {
+        if (edgesIndexed) return;
+        edgesIndexed = true;
+
+        for (size_t k = 0; k < polygons.size(); k++)
+        {
+            polygonFirstRing.push_back(ringPolygon.size());
+            addRingEdges(polygons[k].outer(), k);
+            for (size_t r = 0; r < polygons[k].inners().size(); r++)
+            {
+                addRingEdges(polygons[k].inners()[r], k);
+            }
+        }
+        polygonFirstRing.push_back(ringPolygon.size());
+        if (edges.empty()) return;
+
+        double ymin = edges[0].ymin, ymax = edges[0].ymax;
+        for (std::vector<Edge>::iterator it = edges.begin(); it != edges.end(); it++)
+        {
+            ymin = std::min(ymin, it->ymin);
+            ymax = std::max(ymax, it->ymax);
+        }
+        size_t bandCount = (ymax > ymin)? std::min(edges.size() / 2 + 1, MAX_EDGE_BANDS) : 1;
+        edgeBandMin = ymin;
+        edgeBandHeight = (ymax - ymin) / bandCount;
+        edgeBands.resize(bandCount);
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            for (size_t band = getEdgeBand(edges[i].ymin); band <= getEdgeBand(edges[i].ymax); band++)
+            {
+                edgeBands[band].push_back(i);
+            }
+        }
+        LOG_DEBUG("GeoPolygon::indexEdges(): " << edges.size() << " edges in " << bandCount << " latitude bands");
+    }
+
+    /**
+     * add the edges of a ring, rings boost::geometry::within ignores
+     * (less than 4 points) are recorded without edges
+     */
+    void addRingEdges(const polygon_type::ring_type& ring, int polygon)
+    {
+        int ringIndex = ringPolygon.size();
+        ringPolygon.push_back(polygon);
+        if (ring.size() < 4) return;
+
+        for (size_t i = 1; i < ring.size(); i++)
+        {
+            Edge edge;
+            edge.x1 = ring[i-1].x();
+            edge.y1 = ring[i-1].y();
+            edge.x2 = ring[i].x();
+            edge.y2 = ring[i].y();
+            // repeated vertices do not bound anything
+            if (edge.x1 == edge.x2 && edge.y1 == edge.y2) continue;
+            edge.xmin = std::min(edge.x1, edge.x2);
+            edge.xmax = std::max(edge.x1, edge.x2);
+            edge.ymin = std::min(edge.y1, edge.y2);
+            edge.ymax = std::max(edge.y1, edge.y2);
+            edge.ring = ringIndex;
+            edges.push_back(edge);
+        }
+    }
+
+    // the latitude band of a latitude, clamped to the indexed bands
+    size_t getEdgeBand(double y)
+    {
+        if (edgeBandHeight <= 0 || !(y > edgeBandMin)) return 0;
+        return std::min((size_t)((y - edgeBandMin) / edgeBandHeight), edgeBands.size() - 1);
+    }
+
+    // the most latitude bands the edges are indexed in
+    static constexpr size_t MAX_EDGE_BANDS = 4096;
+
+    // identifies a polygon cache file and its layout
+    static const char* getCacheMagic() { return "GEOPOLY2"; }
+    static constexpr size_t CACHE_MAGIC_SIZE = 8;
+
+    /**
+     * 64-bit FNV-1a hash of a GeoJSON document, naming its cache file
+     */
+    static uint64_t getHash(const std::string& text)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (std::string::const_iterator it = text.begin(); it != text.end(); it++)
+        {
+            hash = (hash ^ (unsigned char)*it) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /**
+     * read the polygons from a cache file: the header (magic, document size
+     * and text, number of polygons), then for each polygon its number of
+     * rings, and for each ring its number of points and their coordinates
+     * the document text is compared, as documents may share a hash
+     * @return false if the file does not exist or is not for this document
+     */
+    bool readCache(const std::string& path, const std::string& geojson)
+    {
+        std::ifstream cache(path.c_str(), std::ios::binary);
+        if (!cache.good()) return false;
+
+        char magic[CACHE_MAGIC_SIZE];
+        uint64_t textSize = geojson.size(), cacheTextSize, polygonCount = 0;
+        cache.read(magic, sizeof(magic));
+        cache.read((char*)&cacheTextSize, sizeof(cacheTextSize));
+        bool matching = cache && std::equal(magic, magic + CACHE_MAGIC_SIZE, getCacheMagic()) && cacheTextSize == textSize;
+        if (matching)
+        {
+            std::string cacheText(textSize, '\0');
+            cache.read(&cacheText[0], textSize);
+            cache.read((char*)&polygonCount, sizeof(polygonCount));
+            matching = cache && cacheText == geojson;
+        }
+        if (!matching)
+        {
+            LOG_WARNING("GeoPolygon::readCache(): ignoring " << path << ", it is not a cache of this bounding shape");
+            return false;
+        }
+
+        multi_polygon_type cached;
+        for (uint64_t k = 0; k < polygonCount && cache; k++)
+        {
+            polygon_type polygon;
+            uint64_t ringCount = 0;
+            cache.read((char*)&ringCount, sizeof(ringCount));
+            for (uint64_t r = 0; r < ringCount && cache; r++)
+            {
+                if (r > 0) polygon.inners().resize(r);
+                polygon_type::ring_type& ring = (r == 0)? polygon.outer() : polygon.inners()[r-1];
+                uint64_t pointCount = 0;
+                cache.read((char*)&pointCount, sizeof(pointCount));
+                std::vector<double> coordinates(cache? 2 * std::min(pointCount, textSize) : 0);
+                cache.read((char*)coordinates.data(), coordinates.size() * sizeof(double));
+                for (size_t i = 0; i + 1 < coordinates.size(); i += 2)
+                {
+                    ring.push_back(point_type(coordinates[i], coordinates[i+1]));
+                }
+            }
+            cached.push_back(polygon);
+        }
+        if (!cache)
+        {
+            LOG_WARNING("GeoPolygon::readCache(): ignoring truncated cache " << path);
+            return false;
+        }
+        polygons.swap(cached);
+        return true;
+    }
+
+    /**
+     * write the polygons to a cache file, replacing it at once so concurrent
+     * requests never read a partial file
+     */
+    void writeCache(const std::string& path, const std::string& geojson)
+    {
+        std::stringstream temporary;
+        temporary << path << ".tmp." << getpid();
+        std::ofstream cache(temporary.str().c_str(), std::ios::binary);
+
+        uint64_t textSize = geojson.size(), polygonCount = polygons.size();
+        cache.write(getCacheMagic(), CACHE_MAGIC_SIZE);
+        cache.write((const char*)&textSize, sizeof(textSize));
+        cache.write(geojson.data(), textSize);
+        cache.write((const char*)&polygonCount, sizeof(polygonCount));
+        for (multi_polygon_type::iterator it = polygons.begin(); it != polygons.end(); it++)
+        {
+            uint64_t ringCount = 1 + it->inners().size();
+            cache.write((const char*)&ringCount, sizeof(ringCount));
+            for (uint64_t r = 0; r < ringCount; r++)
+            {
+                const polygon_type::ring_type& ring = (r == 0)? it->outer() : it->inners()[r-1];
+                uint64_t pointCount = ring.size();
+                cache.write((const char*)&pointCount, sizeof(pointCount));
+                for (polygon_type::ring_type::const_iterator point = ring.begin(); point != ring.end(); point++)
+                {
+                    double coordinates[2] = {point->x(), point->y()};
+                    cache.write((const char*)coordinates, sizeof(coordinates));
+                }
+            }
+        }
+        cache.close();
+
+        if (!cache || rename(temporary.str().c_str(), path.c_str()) != 0)
+        {
+            LOG_WARNING("GeoPolygon::writeCache(): unable to write " << path);
+            remove(temporary.str().c_str());
+            return;
+        }
+        LOG_INFO("GeoPolygon::writeCache(): wrote " << polygons.size() << " polygons to " << path);
+    }
+
     /* stores polygon/multi-polygon vertices
      * std::vector<double> - one vertex of the polygon
      * std::vector<std::vector<double>> - vertices of a polygon
@@ -136,7 +448,7 @@ private:
      * |       |    |
      * +-------+----+- Polygon      # 3D Array (of linear rings of points of [x,y])
      */
-    void readPolygon(property_tree::ptree tree)
+    void readPolygon(const property_tree::ptree& tree)
     {
         LOG_DEBUG("GeoPolygon::readPolygon(): ENTER");
 
@@ -151,7 +463,7 @@ private:
         }
         else if (objType == "FeatureCollection" && tree.get_child_optional("features"))
         {
-            BOOST_FOREACH(property_tree::ptree::value_type &nodei, tree.get_child("features"))
+            BOOST_FOREACH(const property_tree::ptree::value_type &nodei, tree.get_child("features"))
             {
                 readPolygon(nodei.second);
             }
@@ -162,7 +474,7 @@ private:
         }
         else if (objType == "GeometryCollection" && tree.get_child_optional("geometries"))
         {
-            BOOST_FOREACH(property_tree::ptree::value_type &nodei, tree.get_child("geometries"))
+            BOOST_FOREACH(const property_tree::ptree::value_type &nodei, tree.get_child("geometries"))
             {
                 readPolygon(nodei.second);
             }
@@ -174,7 +486,7 @@ private:
      * extract polygon vertices from the tree
      * @param tree GeoJSON content
      */
-    void getCoordinatesFromGeoJSON(property_tree::ptree tree)
+    void getCoordinatesFromGeoJSON(const property_tree::ptree& tree)
     {
         LOG_DEBUG("GeoPolygon::getCoordinatesFromGeoJSON(): ENTER");
 
@@ -188,7 +500,7 @@ private:
         int inner = 0;
         polygon_type poly;
 
-        BOOST_FOREACH(property_tree::ptree::value_type nodei, tree.get_child("coordinates"))
+        BOOST_FOREACH(const property_tree::ptree::value_type &nodei, tree.get_child("coordinates"))
         {
             if (isPolygon)
             {
@@ -209,15 +521,15 @@ private:
      * extract polygon from the tree
      * @param tree GeoJSON content
      */
-    void getPolygon(polygon_type &poly, property_tree::ptree tree, bool outer, int inner)
+    void getPolygon(polygon_type &poly, const property_tree::ptree& tree, bool outer, int inner)
     {
         LOG_DEBUG("GeoPolygon::getPolygon(): ENTER");
 
         std::vector<double> point;
 
-        BOOST_FOREACH(property_tree::ptree::value_type &nodei, tree)
+        BOOST_FOREACH(const property_tree::ptree::value_type &nodei, tree)
         {
-            BOOST_FOREACH(property_tree::ptree::value_type &nodej, nodei.second)
+            BOOST_FOREACH(const property_tree::ptree::value_type &nodej, nodei.second)
             {
                 point.push_back(nodej.second.get_value<double>());
                 if (point.size() == 2) break;
@@ -239,14 +551,14 @@ private:
      * extract multi-polygon from the tree
      * @param tree GeoJSON content
      */
-    void getMultiPolygon(property_tree::ptree tree, polygon_type &poly)
+    void getMultiPolygon(const property_tree::ptree& tree, polygon_type &poly)
     {
         LOG_DEBUG("GeoPolygon::getMultiPolygon(): ENTER");
 
         bool outer = true;
         int inner = 0;
         int counter = 1;
-        BOOST_FOREACH(property_tree::ptree::value_type &nodei, tree)
+        BOOST_FOREACH(const property_tree::ptree::value_type &nodei, tree)
         {
             if (!outer)
             {
@@ -265,7 +577,7 @@ private:
      * @param tree GeoJSON content
      * @return objType type of the object
      */
-    std::string getType(property_tree::ptree tree)
+    std::string getType(const property_tree::ptree& tree)
     {
         std::string objType = "";
         if (tree.get_child_optional("type"))
@@ -277,4 +589,210 @@ private:
     }
 
 };
+
+
+/**
+ * Evaluates whether the points along a trajectory are within a GeoPolygon.
+ *
+ * Consecutive trajectory points are close together, so rather than testing
+ * each point against every polygon edge, the winding number of each ring is
+ * found once at the start of a track, and for each step between consecutive
+ * points only the edges the step crosses are counted, found through the
+ * latitude band index of the polygon edges.
+ *
+ * A point within a small tolerance of an edge, or a step passing that close
+ * to a vertex, is tested with GeoPolygon::contains, as is the point after it,
+ * so points on the boundary are classified as boost::geometry::within does.
+ */
+class PolygonTrack
+{
+public:
+
+    PolygonTrack(GeoPolygon* geoPolygon)
+    : geoPolygon(geoPolygon), insideCount(0), located(false), prevX(0), prevY(0)
+    {
+        geoPolygon->indexEdges();
+        windings.resize(geoPolygon->ringPolygon.size());
+        polygonInside.resize(geoPolygon->polygonFirstRing.size() - 1);
+    }
+
+    /**
+     * start a new track, the next point is located from scratch
+     */
+    void reset() { located = false; }
+
+    /**
+     * determine whether the next point of the track is within the polygon
+     * @param lat latitude
+     * @param lon longitude
+     * @return true if the point is within the polygon, false otherwise
+     */
+    bool contains(double lat, double lon)
+    {
+        double x = geoPolygon->shiftLongitude(lon), y = lat;
+        if (!std::isfinite(x) || !std::isfinite(y))
+        {
+            located = false;
+        }
+        else if (located && x == prevX && y == prevY)
+        {
+            return isInside();
+        }
+        else
+        {
+            located = located? step(x, y) : locate(x, y);
+        }
+
+        if (!located) return geoPolygon->contains(lat, lon);
+        prevX = x;
+        prevY = y;
+        return isInside();
+    }
+
+private:
+
+    GeoPolygon* geoPolygon;
+
+    // the winding number of the last point about each ring, whether it is
+    // within each polygon, and the number of polygons it is within
+    std::vector<int> windings;
+    std::vector<bool> polygonInside;
+    int insideCount;
+    bool located;
+    double prevX, prevY;
+
+    // distance, in degrees, within which a point is considered on an edge
+    static constexpr double EDGE_TOLERANCE = 1e-9;
+
+    // twice the signed area of the triangle (x1, y1), (x2, y2), (x, y),
+    // positive if the point is left of the line from the first to the second point
+    static double orientation(double x1, double y1, double x2, double y2, double x, double y)
+    {
+        return (x2 - x1) * (y - y1) - (y2 - y1) * (x - x1);
+    }
+
+    // the orientation below which a point is within the tolerance of a line
+    static double tolerance(double x1, double y1, double x2, double y2)
+    {
+        return EDGE_TOLERANCE * (std::fabs(x2 - x1) + std::fabs(y2 - y1));
+    }
+
+    static bool isNearBox(const GeoPolygon::Edge& edge, double x, double y)
+    {
+        return x >= edge.xmin - EDGE_TOLERANCE && x <= edge.xmax + EDGE_TOLERANCE &&
+               y >= edge.ymin - EDGE_TOLERANCE && y <= edge.ymax + EDGE_TOLERANCE;
+    }
+
+    /**
+     * visit the edges overlapping a latitude range once each
+     * @return false if the visitor returned false for an edge
+     */
+    template <typename Visitor>
+    bool visitEdges(double ymin, double ymax, Visitor visit)
+    {
+        if (geoPolygon->edgeBands.empty()) return true;
+        size_t first = geoPolygon->getEdgeBand(ymin), last = geoPolygon->getEdgeBand(ymax);
+        for (size_t band = first; band <= last; band++)
+        {
+            std::vector<int>& bandEdges = geoPolygon->edgeBands[band];
+            for (std::vector<int>::iterator it = bandEdges.begin(); it != bandEdges.end(); it++)
+            {
+                const GeoPolygon::Edge& edge = geoPolygon->edges[*it];
+                // an edge is visited in the first band it shares with the range
+                if (band != std::max(first, geoPolygon->getEdgeBand(edge.ymin))) continue;
+                if (!visit(edge)) return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * find the winding numbers of a point by counting the edges crossing the
+     * ray from the point towards increasing longitude
+     * @return false if the point is within the tolerance of an edge
+     */
+    bool locate(double x, double y)
+    {
+        std::fill(windings.begin(), windings.end(), 0);
+        bool found = visitEdges(y - EDGE_TOLERANCE, y + EDGE_TOLERANCE, [&](const GeoPolygon::Edge& edge)
+        {
+            double o = orientation(edge.x1, edge.y1, edge.x2, edge.y2, x, y);
+            bool crossing = (edge.y1 <= y) != (edge.y2 <= y);
+            if ((crossing || isNearBox(edge, x, y)) && std::fabs(o) <= tolerance(edge.x1, edge.y1, edge.x2, edge.y2))
+            {
+                return false;
+            }
+            if (crossing)
+            {
+                if (edge.y1 <= y && o > 0) windings[edge.ring]++;
+                else if (edge.y1 > y && o < 0) windings[edge.ring]--;
+            }
+            return true;
+        });
+
+        std::fill(polygonInside.begin(), polygonInside.end(), false);
+        insideCount = 0;
+        for (size_t k = 0; k < polygonInside.size(); k++) updatePolygon(k);
+        return found;
+    }
+
+    /**
+     * update the winding numbers with the edges crossed by the step from the
+     * last point to a point
+     * @return false if the step or the point is within the tolerance of an edge
+     */
+    bool step(double x, double y)
+    {
+        double xmin = std::min(prevX, x) - EDGE_TOLERANCE, xmax = std::max(prevX, x) + EDGE_TOLERANCE;
+        double ymin = std::min(prevY, y) - EDGE_TOLERANCE, ymax = std::max(prevY, y) + EDGE_TOLERANCE;
+        double stepTolerance = tolerance(prevX, prevY, x, y);
+        return visitEdges(ymin, ymax, [&](const GeoPolygon::Edge& edge)
+        {
+            if (edge.xmax < xmin || edge.xmin > xmax || edge.ymax < ymin || edge.ymin > ymax) return true;
+
+            double edgeTolerance = tolerance(edge.x1, edge.y1, edge.x2, edge.y2);
+            double o1 = orientation(edge.x1, edge.y1, edge.x2, edge.y2, prevX, prevY);
+            double o2 = orientation(edge.x1, edge.y1, edge.x2, edge.y2, x, y);
+            double o3 = orientation(prevX, prevY, x, y, edge.x1, edge.y1);
+            double o4 = orientation(prevX, prevY, x, y, edge.x2, edge.y2);
+            if (std::fabs(o1) <= edgeTolerance || std::fabs(o2) <= edgeTolerance ||
+                std::fabs(o3) <= stepTolerance || std::fabs(o4) <= stepTolerance)
+            {
+                return false;
+            }
+            // the step crosses the edge, to its left side into a ring going
+            // counterclockwise, or to its right side out of it
+            if ((o1 > 0) != (o2 > 0) && (o3 > 0) != (o4 > 0))
+            {
+                windings[edge.ring] += (o2 > 0)? 1 : -1;
+                updatePolygon(geoPolygon->ringPolygon[edge.ring]);
+            }
+            return true;
+        });
+    }
+
+    /**
+     * a point is within a polygon if it is within its outer ring and none of
+     * its inner rings
+     * @param polygon the polygon whose ring winding numbers changed
+     */
+    void updatePolygon(size_t polygon)
+    {
+        int first = geoPolygon->polygonFirstRing[polygon], end = geoPolygon->polygonFirstRing[polygon+1];
+        bool inside = (first < end && windings[first] != 0);
+        for (int r = first + 1; inside && r < end; r++)
+        {
+            if (windings[r] != 0) inside = false;
+        }
+        if (inside != polygonInside[polygon])
+        {
+            polygonInside[polygon] = inside;
+            insideCount += inside? 1 : -1;
+        }
+    }
+
+    // a point is within the multi-polygon if it is within any polygon
+    bool isInside() { return insideCount > 0; }
+
+};
 #endif
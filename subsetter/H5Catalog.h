@@ -0,0 +1,260 @@
+#ifndef H5CATALOG_H
+#define H5CATALOG_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+#include "LogLevel.h"
+
+
+/**
+ * This class catalogs the hierarchy of an input granule once, when the file
+ * is opened, so the phases of a subset (copying groups, expanding the
+ * requested data layers, finding coordinates, checking for matching data)
+ * query it instead of each walking the file with getNumObjs(),
+ * getObjnameByIdx() and getObjTypeByIdx() and reopening its datasets.
+ *
+ * The links of every group are listed in the same order as getObjnameByIdx()
+ * returns them. Datasets are described (dimensions, datatype, layout and
+ * "coordinates" attribute) the first time they are asked for, so a request
+ * for a few variables of a large granule does not open every dataset.
+ *
+ * A group whose links were not all visited, e.g. a group reached by a second
+ * hard link or by a soft link, is listed directly from the file when it is
+ * first asked for.
+ */
+class H5Catalog
+{
+public:
+
+    // an object linked from a group
+    struct Entry
+    {
+        // the link name within the group
+        std::string name;
+
+        // the object type as named by getObjTypeByIdx(), e.g. "group",
+        // "dataset" or "symbolic link"
+        std::string type;
+
+        H5L_type_t linkType;
+
+        // dataset description, valid once described is set
+        bool described;
+        std::vector<hsize_t> dims;
+        H5T_class_t typeClass;
+        size_t typeSize;
+        H5D_layout_t layout;
+        std::vector<hsize_t> chunkDims;
+        bool hasCoordinates;
+        std::string coordinates;
+
+        Entry(const std::string& name = "", const std::string& type = "", H5L_type_t linkType = H5L_TYPE_HARD)
+        : name(name), type(type), linkType(linkType), described(false), typeClass(H5T_NO_CLASS),
+          typeSize(0), layout(H5D_LAYOUT_ERROR), hasCoordinates(false) {}
+    };
+
+    /**
+     * @brief Catalog every group reachable from the root of a file.
+     *
+     * @param file The opened input granule.
+     */
+    H5Catalog(const H5::H5File& file)
+    : file(file)
+    {
+        H5::Group root = file.openGroup("/");
+        addGroup("/", root.getId());
+
+        VisitContext context(this, "/");
+        H5Lvisit(root.getId(), H5_INDEX_NAME, H5_ITER_INC, H5Catalog::addLink, &context);
+
+        size_t objectCount = 0;
+        for (std::map<std::string, Group>::iterator it = groups.begin(); it != groups.end(); it++)
+        {
+            it->second.listed = (it->second.children.size() == it->second.numLinks);
+            objectCount += it->second.children.size();
+        }
+        LOG_DEBUG("H5Catalog::H5Catalog(): cataloged " << objectCount << " objects in " << groups.size() << " groups");
+    }
+
+    /**
+     * @brief Get the objects linked from a group, in link name order.
+     *
+     * @param groupname The group name, e.g. "/" or "/gt1l/heights/".
+     * @return The objects of the group.
+     */
+    const std::vector<Entry>& getChildren(const std::string& groupname)
+    {
+        std::string path = groupname;
+        if (path.empty() || *path.rbegin() != '/') path.push_back('/');
+
+        Group& group = groups[path];
+        if (!group.listed)
+        {
+            listGroup(path, group);
+        }
+        return group.children;
+    }
+
+    /**
+     * @brief Get the description of a dataset.
+     *
+     * @param groupname The name of the dataset's parent group.
+     * @param name The dataset name within the group.
+     * @return The dataset entry, or NULL if the group has no such dataset.
+     */
+    const Entry* getDataset(const std::string& groupname, const std::string& name)
+    {
+        std::string path = groupname;
+        if (path.empty() || *path.rbegin() != '/') path.push_back('/');
+
+        getChildren(path);
+        std::vector<Entry>& children = groups[path].children;
+        for (std::vector<Entry>::iterator it = children.begin(); it != children.end(); it++)
+        {
+            if (it->name == name && it->type == "dataset")
+            {
+                if (!it->described) describeDataset(path + name, *it);
+                return &(*it);
+            }
+        }
+        return NULL;
+    }
+
+private:
+
+    // the links of a group
+    struct Group
+    {
+        hsize_t numLinks;
+        bool listed;
+        std::vector<Entry> children;
+
+        Group() : numLinks(0), listed(false) {}
+    };
+
+    // state passed to the link callback
+    struct VisitContext
+    {
+        H5Catalog* catalog;
+        std::string basePath;
+
+        VisitContext(H5Catalog* catalog, const std::string& basePath) : catalog(catalog), basePath(basePath) {}
+    };
+
+    H5::H5File file;
+
+    // key: group name ending with "/", value: the group's links
+    std::map<std::string, Group> groups;
+
+    /**
+     * @brief Record a group and the number of links it holds.
+     */
+    void addGroup(const std::string& path, hid_t groupId)
+    {
+        H5G_info_t info;
+        Group& group = groups[path];
+        group.numLinks = (H5Gget_info(groupId, &info) >= 0)? info.nlinks : 0;
+    }
+
+    /**
+     * @brief List the links of a group directly from the file.
+     */
+    void listGroup(const std::string& path, Group& group)
+    {
+        LOG_DEBUG("H5Catalog::listGroup(): listing " << path);
+
+        group.children.clear();
+        group.listed = true;
+
+        H5::Group ingroup = file.openGroup(path);
+        addGroup(path, ingroup.getId());
+        VisitContext context(this, path);
+        H5Literate(ingroup.getId(), H5_INDEX_NAME, H5_ITER_INC, NULL, H5Catalog::addLink, &context);
+    }
+
+    /**
+     * @brief Read the dimensions, datatype, layout (with the chunk
+     *        dimensions of chunked datasets) and "coordinates" attribute of
+     *        a dataset.
+     */
+    void describeDataset(const std::string& path, Entry& entry)
+    {
+        H5::DataSet dataset = file.openDataSet(path);
+        H5::DataSpace space = dataset.getSpace();
+        int ndims = space.getSimpleExtentNdims();
+        entry.dims.resize(ndims);
+        if (ndims > 0) space.getSimpleExtentDims(entry.dims.data());
+
+        H5::DataType datatype = dataset.getDataType();
+        entry.typeClass = datatype.getClass();
+        entry.typeSize = datatype.getSize();
+        H5::DSetCreatPropList plist = dataset.getCreatePlist();
+        entry.layout = plist.getLayout();
+        if (entry.layout == H5D_CHUNKED && ndims > 0)
+        {
+            entry.chunkDims.resize(ndims);
+            plist.getChunk(ndims, entry.chunkDims.data());
+        }
+
+        if (dataset.attrExists("coordinates"))
+        {
+            H5::Attribute attr = dataset.openAttribute("coordinates");
+            attr.read(attr.getDataType(), entry.coordinates);
+            entry.hasCoordinates = true;
+        }
+        entry.described = true;
+    }
+
+    /**
+     * @brief H5Lvisit/H5Literate callback adding a link to its parent group.
+     */
+    static herr_t addLink(hid_t location, const char* name, const H5L_info_t* info, void* data)
+    {
+        VisitContext* context = static_cast<VisitContext*>(data);
+        std::string path = context->basePath + name;
+        size_t slash = path.find_last_of('/');
+        std::string parent = path.substr(0, slash + 1);
+
+        Entry entry(path.substr(slash + 1), "unknown", info->type);
+        if (info->type == H5L_TYPE_SOFT)
+        {
+            entry.type = "symbolic link";
+        }
+        else if (info->type != H5L_TYPE_HARD)
+        {
+            entry.type = "user-defined link";
+        }
+        else
+        {
+            hid_t object = H5Oopen(location, name, H5P_DEFAULT);
+            if (object >= 0)
+            {
+                switch (H5Iget_type(object))
+                {
+                    case H5I_GROUP:
+                        entry.type = "group";
+                        context->catalog->addGroup(path + "/", object);
+                        break;
+                    case H5I_DATASET:
+                        entry.type = "dataset";
+                        break;
+                    case H5I_DATATYPE:
+                        entry.type = "datatype";
+                        break;
+                    default:
+                        break;
+                }
+                H5Oclose(object);
+            }
+        }
+
+        context->catalog->groups[parent].children.push_back(entry);
+        return 0;
+    }
+
+};
+
+#endif
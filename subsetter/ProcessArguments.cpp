@@ -2,13 +2,11 @@
 
 
 /**
- * @brief Process the input arguments of the subset request.
+ * @brief Describe the command line options.
  *
- * @param argc The number of input arguments.
- * @param argv The vector of input arguments.
- * @return Error code (0 - success, 1 - error, 2 - show help or no filename)
+ * @return The options description.
  */
-int ProcessArguments::process_args(int argc, char* argv[])
+program_options::options_description ProcessArguments::getOptionsDescription()
 {
     program_options::options_description description("Available Options");
     description.add_options()
@@ -22,11 +20,36 @@ int ProcessArguments::process_args(int argc, char* argv[])
             ("end,e", program_options::value<std::string>(), "Temporal search end")
             ("includedataset,i", program_options::value<std::string>(), "Only include the specified datasets to include in output product")
             ("boundingshape,p", program_options::value<std::string>(), "Bounding shape(polygon) or .geojson file")
+            ("shapecache", program_options::value<std::string>(), "Directory caching the polygons read from each bounding shape, so a repeated bounding shape is not parsed again")
             ("reformat,r", program_options::value<std::string>(), "Change the output format (-r GeoTIFF)")
             ("crs,j", program_options::value<std::string>(), "Reproject to the coordinate reference system (e.g. EPSG:4326")
             ("shortname,n", program_options::value<std::string>(), "The collection shortName for granules that do not contain a shortName variable (ATL24)")
             ("loglevel,l", program_options::value<std::string>(), "The log level can be DEBUG, INFO, WARNING, ERROR, or CRITICAL)")
-            ("logfile,g", program_options::value<std::string>(), "Name of log output file");
+            ("logfile,g", program_options::value<std::string>(), "Name of log output file")
+            ("copyfilerange", "Copy contiguous datasets with copy_file_range instead of buffered reads and writes")
+            ("estimate", "Only compute the index selections and write a JSON estimate of the subset to --outfile, or to standard output without one")
+            ("inmemory", program_options::value<long>(), "Build the output in memory, then write it in one pass, for inputs up to this many MB")
+            ("inputfd", program_options::value<int>(), "Read the input granule as a file image from this open file descriptor (e.g. a memfd) instead of --filename")
+            ("fileimage", "Map the input file into memory and open it as a file image")
+            ("daemon", program_options::value<std::string>(), "Serve JSON subset requests on this UNIX domain socket path instead of subsetting --filename")
+            ("manifest", program_options::value<std::string>(), "Subset every job of this manifest, one JSON request per line, instead of --filename")
+            ("maxjobs", program_options::value<unsigned int>(), "The maximum number of daemon requests or manifest jobs handled at once (default: number of cores)")
+            ("memorybudget", program_options::value<long>(), "The estimated memory, in MB, the concurrent manifest jobs may use")
+            ("region", program_options::value<std::vector<std::string> >(), "A named region subset to its own output, as a JSON object with \"name\", \"outfile\" and \"bbox\", \"boundingshape\" or \"start\"/\"end\" constraints; a region keeps the request's spatial or temporal constraints when it defines none of that kind (repeatable)");
+
+    return description;
+}
+
+/**
+ * @brief Process the input arguments of the subset request.
+ *
+ * @param argc The number of input arguments.
+ * @param argv The vector of input arguments.
+ * @return Error code (0 - success, 1 - error, 2 - show help or no filename)
+ */
+int ProcessArguments::process_args(int argc, char* argv[])
+{
+    program_options::options_description description = getOptionsDescription();
 
     program_options::variables_map variables_map;
     program_options::store(program_options::command_line_parser(argc, argv).options(description).run(), variables_map);
@@ -34,13 +57,26 @@ int ProcessArguments::process_args(int argc, char* argv[])
 
     setLogLevel(variables_map);
 
+    // A daemon or a batch only needs the configuration file up front, the
+    // remaining options arrive with each request or manifest job.
+    setDaemon(variables_map);
+    if (setManifest(variables_map) == ERROR) return ERROR;
+    if (!daemonSocket.empty() || !manifest.empty())
+    {
+        setConfigFile(variables_map);
+        return PASS;
+    }
+
     if (showHelpVerifyFilename(description, variables_map) == SHOW_HELP_OR_NO_FILENAME)
         return SHOW_HELP_OR_NO_FILENAME;
     if (setInFileName(variables_map) == ERROR) return ERROR;
+    if (setRegions(variables_map) == ERROR) return ERROR;
+    setEstimate(variables_map);
     if (setOutFileName(variables_map) == ERROR) return ERROR;
     if (setBoundingBox(variables_map) == ERROR) return ERROR;
     if (setStartEndTemporalParameters(variables_map) == ERROR) return ERROR;
     if (setBoundingShape(variables_map) == ERROR) return ERROR;
+    if (setInMemoryOutputCap(variables_map) == ERROR) return ERROR;
 
     setSubsettype(variables_map);
     setConfigFile(variables_map);
@@ -48,6 +84,7 @@ int ProcessArguments::process_args(int argc, char* argv[])
     setReformat(variables_map);
     setCRS(variables_map);
     setCollectionShortname(variables_map);
+    setCopyFileRange(variables_map);
 
     return PASS;
 }
@@ -125,12 +162,55 @@ void ProcessArguments::setCollectionShortname(program_options::variables_map var
     boost::trim_right(collShortName);
 }
 
+void ProcessArguments::setCopyFileRange(program_options::variables_map variables_map)
+{
+    // Copy contiguous datasets in the kernel, if requested.
+    copyFileRange = variables_map.count("copyfilerange") > 0;
+    if (copyFileRange)
+        LOG_INFO("Subset::process_args(): copying contiguous datasets with copy_file_range");
+}
+
+void ProcessArguments::setEstimate(program_options::variables_map variables_map)
+{
+    // Only estimate the subset, without writing an output granule, if requested.
+    estimate = variables_map.count("estimate") > 0;
+    if (estimate)
+        LOG_INFO("Subset::process_args(): estimating the subset, no output granule is written");
+}
+
+void ProcessArguments::setDaemon(program_options::variables_map variables_map)
+{
+    // Access the daemon socket path and concurrency, if specified.
+    daemonSocket = (variables_map.count("daemon"))? variables_map["daemon"].as<std::string>() : "";
+    maxJobs = (variables_map.count("maxjobs"))? variables_map["maxjobs"].as<unsigned int>() : 0;
+    if (!daemonSocket.empty())
+        LOG_INFO("Subset::process_args(): daemon: " << daemonSocket);
+}
+
+int ProcessArguments::setManifest(program_options::variables_map variables_map)
+{
+    // Access the batch manifest and memory budget, if specified.
+    manifest = (variables_map.count("manifest"))? variables_map["manifest"].as<std::string>() : "";
+    if (variables_map.count("memorybudget"))
+    {
+        memoryBudgetMB = variables_map["memorybudget"].as<long>();
+        if (memoryBudgetMB <= 0)
+        {
+            LOG_ERROR("Subset::process_args(): ERROR: --memorybudget must be a positive number of MB");
+            return ERROR;
+        }
+    }
+    if (!manifest.empty())
+        LOG_INFO("Subset::process_args(): manifest: " << manifest);
+    return PASS;
+}
+
 int ProcessArguments::showHelpVerifyFilename(program_options::options_description description,
                                              program_options::variables_map variables_map)
 {
     // Print out the defined command options when the user either types
-    // "help" or does not include a filename.
-    if (variables_map.count("help") || !variables_map.count("filename"))
+    // "help" or does not include a filename or input file descriptor.
+    if (variables_map.count("help") || (!variables_map.count("filename") && !variables_map.count("inputfd")))
     {
         LOG_ERROR(description);
         return SHOW_HELP_OR_NO_FILENAME;
@@ -141,6 +221,26 @@ int ProcessArguments::showHelpVerifyFilename(program_options::options_descriptio
 
 int ProcessArguments::setInFileName(program_options::variables_map variables_map)
 {
+    fileImage = variables_map.count("fileimage") > 0;
+
+    // Access the input file descriptor, if specified. The file name, if
+    // also given, only describes the input in the output file.
+    if (variables_map.count("inputfd"))
+    {
+        inputFd = variables_map["inputfd"].as<int>();
+        struct stat fdStat;
+        if (inputFd < 0 || fstat(inputFd, &fdStat) != 0)
+        {
+            LOG_ERROR("Subset::setInFileName(): ERROR: Could not access input file descriptor " << inputFd);
+            return ERROR;
+        }
+        fileImage = true;
+        infilename = (variables_map.count("filename"))? variables_map["filename"].as<std::string>()
+                                                      : "fd" + std::to_string(inputFd);
+        LOG_INFO("Subset::process_args(): inputfd: " << inputFd);
+        return PASS;
+    }
+
     // Access filename from the input command, if specified.
     infilename = variables_map["filename"].as<std::string>();
     LOG_INFO("Subset::process_args(): filename: " << infilename);
@@ -157,6 +257,14 @@ int ProcessArguments::setOutFileName(program_options::variables_map variables_ma
 {
     // Access output file from the input command, if specfied.
     if (variables_map.count("outfile")) outfilename = variables_map["outfile"].as<std::string>();
+
+    // With regions, the output file only names the region outputs, which
+    // are checked as each region is subset.
+    if (!regions.empty()) return PASS;
+
+    // An estimate without an output file is written to standard output.
+    if (estimate && outfilename.empty()) return PASS;
+
     if (outfilename.find("--") == 0 || !std::ofstream(outfilename.c_str()))
     {
         LOG_ERROR("Subset::setOutFileName(): ERROR: Could not open output file " << outfilename);
@@ -234,23 +342,33 @@ int ProcessArguments::setStartEndTemporalParameters(program_options::variables_m
 
 int ProcessArguments::setBoundingShape(program_options::variables_map variables_map)
 {
+    // Access the bounding shape cache directory, if specified.
+    if (variables_map.count("shapecache"))
+    {
+        shapeCacheDir = variables_map["shapecache"].as<std::string>();
+    }
+
     // Access bounding shape, if specfied.
     if (variables_map.count("boundingshape"))
     {
-        std::string boundingShape = variables_map["boundingshape"].as<std::string>();
+        boundingShape = variables_map["boundingshape"].as<std::string>();
         bool isGeoJson = boundingShape.find("geojson") != std::string::npos;
 
         try
         {
-            if (isGeoJson && std::ifstream(boundingShape).good())
+            std::ifstream geoJsonFile;
+            if (isGeoJson) geoJsonFile.open(boundingShape.c_str(), std::ios::binary);
+            if (isGeoJson && geoJsonFile.good())
             {
-                property_tree::read_json(boundingShape, boundingShapePt);
-            }
-            else
-            {
-                std::stringstream ss(boundingShape);
-                property_tree::read_json(ss, boundingShapePt);
+                std::stringstream contents;
+                contents << geoJsonFile.rdbuf();
+                if (geoJsonFile.bad())
+                {
+                    throw std::ios_base::failure("unable to read " + boundingShape);
+                }
+                boundingShape = contents.str();
             }
+            geoPolygon = std::make_shared<GeoPolygon>(boundingShape, shapeCacheDir);
         }
         catch (const boost::property_tree::json_parser::json_parser_error &e)
         {
@@ -271,3 +389,191 @@ int ProcessArguments::setBoundingShape(program_options::variables_map variables_
 
     return PASS;
 }
+
+/**
+ * @brief Parse the bounding shape into a property tree.
+ *
+ * @return The bounding shape, or an empty tree without one.
+ */
+property_tree::ptree ProcessArguments::getBoundingShapePt()
+{
+    property_tree::ptree boundingShapePt;
+    if (!boundingShape.empty())
+    {
+        std::stringstream ss(boundingShape);
+        property_tree::read_json(ss, boundingShapePt);
+    }
+    return boundingShapePt;
+}
+
+int ProcessArguments::setInMemoryOutputCap(program_options::variables_map variables_map)
+{
+    // Access the in-memory output cap, if specified.
+    if (variables_map.count("inmemory"))
+    {
+        inMemoryOutputCapMB = variables_map["inmemory"].as<long>();
+        if (inMemoryOutputCapMB <= 0)
+        {
+            LOG_ERROR("Subset::process_args(): ERROR: Invalid in-memory output cap: " << inMemoryOutputCapMB << " MB");
+            return ERROR;
+        }
+        LOG_INFO("Subset::process_args(): building output in memory for inputs up to " << inMemoryOutputCapMB << " MB");
+    }
+
+    return PASS;
+}
+
+int ProcessArguments::setRegions(program_options::variables_map variables_map)
+{
+    // Access the named regions, if specified.
+    if (variables_map.count("region"))
+    {
+        std::vector<std::string> regionStrings = variables_map["region"].as<std::vector<std::string> >();
+        for (std::vector<std::string>::iterator it = regionStrings.begin(); it != regionStrings.end(); it++)
+        {
+            property_tree::ptree regionPt;
+            try
+            {
+                std::stringstream ss(*it);
+                property_tree::read_json(ss, regionPt);
+            }
+            catch (const boost::property_tree::json_parser::json_parser_error &e)
+            {
+                LOG_ERROR("Subset::process_args(): ERROR: Invalid region: " << e.what());
+                return ERROR;
+            }
+            if (regionPt.get<std::string>("name", "").empty())
+            {
+                LOG_ERROR("Subset::process_args(): ERROR: region without a name: " << *it);
+                return ERROR;
+            }
+            regions.push_back(regionPt);
+        }
+        LOG_INFO("Subset::process_args(): " << regions.size() << " regions");
+    }
+
+    return PASS;
+}
+
+/**
+ * @brief Build the arguments of one region: the arguments of the request,
+ *        with the region's spatial and temporal constraints and output file.
+ *
+ *        A region's bounding boxes or bounding shape replace the spatial
+ *        constraints of the request, and its start and end replace the
+ *        temporal constraint. A region inherits the kind of constraint it
+ *        does not define, e.g. a region with only a start and end is
+ *        limited to the request's bounding boxes or shape as well. Without
+ *        an "outfile", the region is written to the output file name with
+ *        "_<name>" before its extension.
+ *
+ * @param index The region index.
+ * @param regionArgs The region arguments.
+ * @return Error code (0 - success, 1 - error)
+ */
+int ProcessArguments::getRegionArguments(size_t index, std::shared_ptr<ProcessArguments>& regionArgs)
+{
+    property_tree::ptree regionPt = regions.at(index);
+    std::string name = regionPt.get<std::string>("name");
+    regionPt.erase("name");
+    if (regionPt.count("outfile") == 0)
+    {
+        size_t extension = outfilename.find_last_of('.');
+        if (extension == std::string::npos || extension < outfilename.find_last_of('/') + 1)
+            extension = outfilename.size();
+        regionPt.put("outfile", outfilename.substr(0, extension) + "_" + name + outfilename.substr(extension));
+    }
+
+    std::vector<std::string> arguments = requestToArguments(regionPt);
+    std::vector<char*> argv;
+    for (std::vector<std::string>::iterator it = arguments.begin(); it != arguments.end(); it++)
+    {
+        argv.push_back(const_cast<char*>(it->c_str()));
+    }
+    program_options::variables_map variables_map;
+    program_options::store(program_options::command_line_parser(argv.size(), argv.data())
+                           .options(getOptionsDescription()).run(), variables_map);
+    program_options::notify(variables_map);
+
+    LOG_INFO("Subset::process_args(): region: " << name);
+    regionArgs = std::make_shared<ProcessArguments>(*this);
+    regionArgs->regions.clear();
+    if (variables_map.count("bbox") || variables_map.count("boundingshape"))
+    {
+        regionArgs->bounding_box.clear();
+        regionArgs->geoboxes = nullptr;
+        regionArgs->boundingShape.clear();
+        regionArgs->geoPolygon.reset();
+    }
+    if (variables_map.count("start") || variables_map.count("end"))
+    {
+        regionArgs->startString.clear();
+        regionArgs->endString.clear();
+    }
+
+    if (regionArgs->setOutFileName(variables_map) == ERROR) return ERROR;
+    if (regionArgs->setBoundingBox(variables_map) == ERROR) return ERROR;
+    if (variables_map.count("start") || variables_map.count("end"))
+    {
+        if (regionArgs->setStartEndTemporalParameters(variables_map) == ERROR) return ERROR;
+    }
+    if (regionArgs->setBoundingShape(variables_map) == ERROR) return ERROR;
+
+    return PASS;
+}
+
+/**
+ * @brief Convert a JSON request into command line style arguments.
+ *
+ *        Keys are the option names, without the leading "--". Strings are
+ *        option values, true marks a flag, arrays repeat an option and
+ *        objects (e.g. an inline bounding shape) are passed as JSON.
+ *
+ * @param request The JSON request.
+ * @return The arguments, starting with a program name.
+ */
+std::vector<std::string> ProcessArguments::requestToArguments(const property_tree::ptree& request)
+{
+    std::vector<std::string> arguments(1, "subset");
+    for (property_tree::ptree::const_iterator it = request.begin(); it != request.end(); it++)
+    {
+        const std::string option = "--" + it->first;
+        if (it->second.empty())
+        {
+            // A flag, or an option with a single value.
+            std::string value = it->second.data();
+            if (value == "true")
+            {
+                arguments.push_back(option);
+            }
+            else if (value != "false")
+            {
+                arguments.push_back(option);
+                arguments.push_back(value);
+            }
+        }
+        else if (!it->second.begin()->first.empty())
+        {
+            // An object, such as an inline GeoJSON bounding shape.
+            arguments.push_back(option);
+            arguments.push_back(toJson(it->second));
+        }
+        else
+        {
+            // A repeated option, such as several bounding boxes or regions.
+            for (property_tree::ptree::const_iterator value = it->second.begin(); value != it->second.end(); value++)
+            {
+                arguments.push_back(option);
+                arguments.push_back(value->second.empty()? value->second.data() : toJson(value->second));
+            }
+        }
+    }
+    return arguments;
+}
+
+std::string ProcessArguments::toJson(const property_tree::ptree& object)
+{
+    std::stringstream json;
+    property_tree::write_json(json, object, false);
+    return json.str();
+}
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <sys/stat.h>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -19,6 +20,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "geobox.h"
+#include "GeoPolygon.h"
 #include "LogLevel.h"
 
 namespace program_options = boost::program_options;
@@ -32,6 +34,9 @@ public:
     static constexpr int SHOW_HELP_OR_NO_FILENAME = 2;
 
     int process_args(int argc, char* argv[]);
+    int getRegionArguments(size_t index, std::shared_ptr<ProcessArguments>& regionArgs);
+
+    static std::vector<std::string> requestToArguments(const property_tree::ptree& request);
 
     std::string getInfilename() { return infilename; }
     std::string getOutfilename() { return outfilename; }
@@ -47,12 +52,27 @@ public:
     std::string getLogLevel() { return logLevel; }
     std::string getLogFile() { return logFile; }
     bool isReproject() { return reproject; }
+    bool isCopyFileRange() { return copyFileRange; }
+    bool isEstimate() { return estimate; }
+    long getInMemoryOutputCapMB() { return inMemoryOutputCapMB; }
+    int getInputFd() { return inputFd; }
+    bool isFileImage() { return fileImage; }
+    std::string getDaemonSocket() { return daemonSocket; }
+    unsigned int getMaxJobs() { return maxJobs; }
+    std::string getManifest() { return manifest; }
+    long getMemoryBudgetMB() { return memoryBudgetMB; }
+    size_t getRegionCount() { return regions.size(); }
 
     std::vector<geobox> *getGeoboxes() { return geoboxes; }
     std::vector<std::string> getDatasetsToInclude() { return datasetsToInclude; }
-    boost::property_tree::ptree getBoundingShapePt() { return boundingShapePt; }
+    std::string getBoundingShape() { return boundingShape; }
+    boost::property_tree::ptree getBoundingShapePt();
+    GeoPolygon* getGeoPolygon() { return geoPolygon.get(); }
 
 private:
+    static program_options::options_description getOptionsDescription();
+    static std::string toJson(const property_tree::ptree& object);
+
     void setLogLevel(program_options::variables_map variables_map);
     void setSubsettype(program_options::variables_map variables_map);
     void setConfigFile(program_options::variables_map variables_map);
@@ -60,6 +80,9 @@ private:
     void setReformat(program_options::variables_map variables_map);
     void setCRS(program_options::variables_map variables_map);
     void setCollectionShortname(program_options::variables_map variables_map);
+    void setCopyFileRange(program_options::variables_map variables_map);
+    void setEstimate(program_options::variables_map variables_map);
+    void setDaemon(program_options::variables_map variables_map);
 
     int showHelpVerifyFilename(program_options::options_description description,
                                        program_options::variables_map variables_map);
@@ -68,6 +91,9 @@ private:
     int setBoundingBox(program_options::variables_map variables_map);
     int setStartEndTemporalParameters(program_options::variables_map variables_map);
     int setBoundingShape(program_options::variables_map variables_map);
+    int setInMemoryOutputCap(program_options::variables_map variables_map);
+    int setManifest(program_options::variables_map variables_map);
+    int setRegions(program_options::variables_map variables_map);
 
     std::string infilename;
     std::string outfilename;
@@ -83,10 +109,22 @@ private:
     std::string logLevel;
     std::string logFile;
     bool reproject;
+    bool copyFileRange = false;
+    bool estimate = false;
+    long inMemoryOutputCapMB = 0;
+    int inputFd = -1;
+    bool fileImage = false;
+    std::string daemonSocket;
+    unsigned int maxJobs = 0;
+    std::string manifest;
+    long memoryBudgetMB = 0;
 
     std::vector<geobox> *geoboxes = nullptr; // Multiple bounding boxes can be specified.
     std::vector<std::string> datasetsToInclude;
-    boost::property_tree::ptree boundingShapePt;
+    std::string boundingShape; // The bounding shape GeoJSON content.
+    std::string shapeCacheDir;
+    std::shared_ptr<GeoPolygon> geoPolygon; // The polygons read from the bounding shape.
+    std::vector<boost::property_tree::ptree> regions; // Named regions, each subset to its own output.
 
 };
 
@@ -1,6 +1,9 @@
 #ifndef REVERSEREFERENCECOORDINATES_H
 #define	REVERSEREFERENCECOORDINATES_H
 
+#include <algorithm>
+#include <vector>
+
 #include "Configuration.h"
 #include "LogLevel.h"
 
@@ -96,52 +99,70 @@ public:
 
         return indexes;
     }
-private:
-
-    IndexSelection* referencedIndexes;
-    std::string shortname;
-    H5::Group ingroup;
 
     /*
-     * limit the index range by referenced group indexSelection
-     * @param DataSet indexBegSet: index begin dataset
+     * add the rows of which the index begin value is within a referenced
+     * index selection pair to an index selection
+     * @param vector indexBegin: index begin values (one based) of the rows
+     * @param IndexSelection referencedIndexes: index selection of the referenced group
+     * @param IndexSelection indexes: index selection the rows are added to
      */
-    void reverseSubset(H5::DataSet* indexBegSet)
+    template <typename T>
+    static void selectReferencingRows(const std::vector<T>& indexBegin, IndexSelection& referencedIndexes, IndexSelection& indexes)
     {
-        LOG_DEBUG("ReverseReferenceCoordinates::reverseSubset(): ENTER");
+        size_t coordinateSize = indexBegin.size();
+        long start = 0, length = 0, end = 0, newStart = 0, newLength = 0;
 
-        int32_t* indexBegin = new int32_t[coordinateSize];
-        LOG_DEBUG("ReverseReferenceCoordinates::reverseSubset(): coordinateSize:" << coordinateSize);
-        indexBegSet->read(indexBegin, indexBegSet->getDataType());
-        long start = 0, length = 0, end = 0, count = 0, newStart = 0, newLength = 0;
+        // the index begin values of a trajectory do not decrease, apart from
+        // fill values, so the rows matching each referenced index selection
+        // pair are found by one sweep over both, with the other rows checked
+        // from both ends for each pair only if the values are out of order
+        bool sorted = isSortedIgnoringFill(indexBegin);
+        size_t first = 0, last = 0;
 
         // iterate through index selection of the referenced group (i.e., for leads group ,iterate through freeboard swath group)
         // if the value in the index begin dataset  matches the indices in the index selection,
         // calculate the index range for that value, add it the index selection
-        for (std::map<long, long>::iterator it = referencedIndexes->segments.begin(); it != referencedIndexes->segments.end(); it++)
+        for (std::map<long, long>::iterator it = referencedIndexes.segments.begin(); it != referencedIndexes.segments.end(); it++)
         {
             start = it->first + 1;
             length = it->second;
             end = start + length;
 
+            // start and end are at least 1, and compared in the type of the values
+            T startValue = (T)start, endValue = (T)end;
+
+            if (sorted)
+            {
+                // the rows from the first non-fill value not less than start
+                // up to the first value not less than end, without the fill
+                // values following the last row within the pair
+                while (first < coordinateSize && (!(indexBegin[first] > 0) || indexBegin[first] < startValue)) first++;
+                if (last < first) last = first;
+                while (last < coordinateSize && indexBegin[last] < endValue) last++;
+                size_t stop = last;
+                while (stop > first && !(indexBegin[stop - 1] > 0)) stop--;
+                indexes.addSegment(first, stop - first);
+                continue;
+            }
 
             // if start is greater than the last value in the index begin dataset
             // skip this referenced index selection pair
-            if (start > indexBegin[coordinateSize-1])
+            if (startValue > indexBegin[coordinateSize-1])
             {
                 continue;
             }
 
             // if end is less than the first value in the index begin dataset
             // skip this referenced index selection pair
-            if (end < indexBegin[0])
+            if (endValue < indexBegin[0])
             {
                 continue;
             }
 
-            for (int i = 0; i < coordinateSize; i++)
+            for (size_t i = 0; i < coordinateSize; i++)
             {
-                if (indexBegin[i] >= start)
+                if (indexBegin[i] >= startValue)
                 {
                     newStart = i;
                     break;
@@ -149,48 +170,107 @@ private:
 
             }
 
-            for (int i = coordinateSize-1; i >= 0; i--)
+            for (long i = (long)coordinateSize - 1; i >= 0; i--)
             {
-                if (indexBegin[i] < end)
+                if (indexBegin[i] < endValue)
                 {
                     newLength = i + 1 - newStart;
-                    indexes->addSegment(newStart, newLength);
+                    indexes.addSegment(newStart, newLength);
                     break;
                 }
             }
         }
 
         // if no spatial subsetting
-        if (referencedIndexes->segments.empty())
+        if (referencedIndexes.segments.empty())
         {
             // index selection end is excluded
-            start = referencedIndexes->minIndexStart;
-            end = referencedIndexes->maxIndexEnd;
-
+            start = referencedIndexes.minIndexStart;
+            end = referencedIndexes.maxIndexEnd;
+            T startValue = (T)start, endValue = (T)end;
 
-            for (int i = 0; i < coordinateSize; i++)
+            for (size_t i = 0; i < coordinateSize; i++)
             {
-                if (indexBegin[i] > start)
+                if (indexBegin[i] > startValue)
                 {
                     newStart = i;
                     break;
                 }
             }
-            for (int i = coordinateSize-1; i >= 0; i--)
+            for (long i = (long)coordinateSize - 1; i >= 0; i--)
             {
-                if (indexBegin[i] <= end)
+                if (indexBegin[i] <= endValue)
                 {
                     newLength = i + 1 - newStart;
-                    indexes->addSegment(newStart, newLength);
+                    indexes.addSegment(newStart, newLength);
                     break;
                 }
             }
         }
 
         // if no matching data found, return no data
-        if (indexes->segments.empty()) indexes->addRestriction(0, 0);
+        if (indexes.segments.empty()) indexes.addRestriction(0, 0);
+    }
+
+private:
+
+    IndexSelection* referencedIndexes;
+    std::string shortname;
+    H5::Group ingroup;
+
+    /*
+     * limit the index range by referenced group indexSelection
+     * @param DataSet indexBegSet: index begin dataset
+     */
+    void reverseSubset(H5::DataSet* indexBegSet)
+    {
+        LOG_DEBUG("ReverseReferenceCoordinates::reverseSubset(): ENTER");
+
+        // read the index begin dataset in its own integer type
+        hid_t datatype = H5Dget_type(indexBegSet->getId());
+        hid_t nativeType = H5Tget_native_type(datatype, H5T_DIR_ASCEND);
+        if (H5Tequal(nativeType, H5T_NATIVE_LLONG)) // 64-bit int
+            reverseSubset<long long>(indexBegSet, H5::PredType::NATIVE_LLONG);
+        else if (H5Tequal(nativeType, H5T_NATIVE_ULLONG)) // unsigned 64-bit int
+            reverseSubset<unsigned long long>(indexBegSet, H5::PredType::NATIVE_ULLONG);
+        else if (H5Tequal(nativeType, H5T_NATIVE_UINT)) // unsigned 32-bit int
+            reverseSubset<uint32_t>(indexBegSet, H5::PredType::NATIVE_UINT);
+        else // 32-bit int, other types are converted
+            reverseSubset<int32_t>(indexBegSet, H5::PredType::NATIVE_INT);
+        H5Tclose(nativeType);
+        H5Tclose(datatype);
+    }
 
-        delete [] indexBegin;
+    template <typename T>
+    void reverseSubset(H5::DataSet* indexBegSet, const H5::PredType& memType)
+    {
+        LOG_DEBUG("ReverseReferenceCoordinates::reverseSubset(): coordinateSize:" << coordinateSize);
+
+        if (coordinateSize == 0)
+        {
+            indexes->addRestriction(0, 0);
+            return;
+        }
+
+        std::vector<T> indexBegin(coordinateSize);
+        indexBegSet->read(indexBegin.data(), memType);
+        selectReferencingRows(indexBegin, *referencedIndexes, *indexes);
+    }
+
+    // whether the index begin values other than fill values (<= 0) do not decrease
+    template <typename T>
+    static bool isSortedIgnoringFill(const std::vector<T>& indexBegin)
+    {
+        bool found = false;
+        T previous = 0;
+        for (typename std::vector<T>::const_iterator it = indexBegin.begin(); it != indexBegin.end(); it++)
+        {
+            if (!(*it > 0)) continue;
+            if (found && *it < previous) return false;
+            previous = *it;
+            found = true;
+        }
+        return true;
     }
 
 };
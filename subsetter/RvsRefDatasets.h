@@ -2,6 +2,9 @@
 #define RVSREFDATASETS_H
 
 #include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
 #include "LogLevel.h"
 
 /**
@@ -34,140 +37,135 @@ public:
     {
         LOG_DEBUG("RvsRefDatasets::mapWriteDataset(): ENTER groupname: " << groupname);
 
-        size_t inDatasetSize = indataset.getSpace().getSimpleExtentNpoints(); // input dataset size
         size_t subsettedSize = indexes->size(); // subsetted dataset size
-        int32_t* inData = new int32_t[inDatasetSize]; // array to store input dataset
-        int32_t* indexRef = new int32_t[subsettedSize]; // array to store subsetted index reference dataset
-        int32_t* newIndexRef = new int32_t[subsettedSize]; // array to store repaired index reference dataset
-        bool diffIndex = false;
-
-        indataset.read(inData, indataset.getDataType());
-        int index = 0;
-        // copy index from the input file according to indexes
-        if (indexes->segments.empty())
+        std::vector<int32_t> indexRef(subsettedSize); // subsetted index reference dataset
+        std::vector<int32_t> newIndexRef(subsettedSize); // repaired index reference dataset
+
+        // read only the selected rows of the input dataset
+        H5::DataSpace inspace = indataset.getSpace();
+        selectRows(inspace, indexes);
+        hsize_t memdims[1] = {subsettedSize};
+        H5::DataSpace memspace(1, memdims);
+        indataset.read(indexRef.data(), H5::PredType::NATIVE_INT, memspace, inspace);
+
+        // ranks - for each row of the referenced group, the number of selected
+        // rows before it, so a reference to a selected row becomes its position
+        // in the subsetted group, and a reference to a row that is not selected
+        // (or outside the group) becomes the dataset's fill value
+        std::vector<int32_t> ranks;
+        getRanks(targetIndexes, ranks);
+        long targetSize = ranks.size() - 1;
+        int32_t fillValue = getFillValue(indataset);
+
+        for (size_t i = 0; i < subsettedSize; i++)
         {
-            for (int i = indexes->minIndexStart; i < indexes->maxIndexEnd; i++)
-            {
-                indexRef[index] = inData[i];
-                index++;
-            }
+            // if indexRef is 0 or -1, copy over
+            int32_t reference = indexRef[i];
+            long row = std::min(std::max((long)reference - 1, 0L), targetSize - 1);
+            bool selected = (reference > 0 && reference <= targetSize && ranks[row + 1] > ranks[row]);
+            newIndexRef[i] = (reference == 0 || reference == -1)? reference : (selected? ranks[row] + 1 : fillValue);
         }
-        else
+
+         // write the index dataset
+        int dimnum = indataset.getSpace().getSimpleExtentNdims();
+        hsize_t olddims[dimnum], newdims[dimnum], maxdims[dimnum];
+        indataset.getSpace().getSimpleExtentDims(olddims, maxdims);
+        newdims[0] = subsettedSize;
+        for (int d = 1; d < dimnum; d++) newdims[d] = olddims[d];
+
+        // contiguous datasets can't be extendible, so the subset dimensions
+        // are also the maximum dimensions
+        H5::DSetCreatPropList plist = indataset.getCreatePlist();
+        if (plist.getLayout() == H5D_CONTIGUOUS)
         {
-            for (std::map<long, long>::iterator it = indexes->segments.begin(); it != indexes->segments.end(); it++)
-            {
-                for (int i = it->first; i < (it->first+it->second); i++)
-                {
-                    indexRef[index] = inData[i];
-                    index++;
-                }
-            }
+            for (int d = 0; d < dimnum; d++) maxdims[d] = newdims[d];
         }
 
-        // location - new index value
-        // offset - difference between new index and previous new index
-        // prevLocation - previous new index
-        // count - keeps track of how many indices in the (start, length) have been accounted for
-        // prevOldLocation - previous index
-        int32_t location = 1, offset = 0, prevLocation = 1, count = 0, prevOldLocation = 0;
+        H5::DataSpace outspace(dimnum, newdims, maxdims);
+        H5::DataType datatype(indataset.getDataType());
+        H5::DataSet outdataset(outgroup.createDataSet(datasetName, datatype, outspace, plist));
+        outdataset.write(newIndexRef.data(), H5::PredType::NATIVE_INT, H5::DataSpace::ALL, outspace);
+
+    }
 
-        long start = 0, length = 0, end = 0, prevLength = 0;
+private:
 
-        // if only temporal constraint is specified
-        if (targetIndexes->segments.empty())
+    /**
+     * select the rows of a dataset in an index selection
+     * @param space DataSpace the dataset's dataspace
+     * @param indexes IndexSelection the selected rows
+     */
+    static void selectRows(H5::DataSpace& space, IndexSelection* indexes)
+    {
+        hsize_t offset[1], count[1];
+        if (indexes->segments.empty())
         {
-            start = (targetIndexes->minIndexStart)+1;
-            end = targetIndexes->maxIndexEnd;
-            length = end - start;
+            offset[0] = indexes->minIndexStart;
+            count[0] = indexes->maxIndexEnd - indexes->minIndexStart;
+            space.selectHyperslab(H5S_SELECT_SET, count, offset);
+            return;
         }
 
-        std::map<long, long>::iterator startIter = targetIndexes->segments.begin();
-
-        // walk through the subsetted index and targetIndexes
-        for (int i = 0; i < subsettedSize; i++)
+        space.selectNone();
+        for (std::map<long, long>::iterator it = indexes->segments.begin(); it != indexes->segments.end(); it++)
         {
-            // if indexRef is 0 or -1, copy over
-            if (indexRef[i] == 0 || indexRef[i] == -1)
-            {
-                newIndexRef[i] = indexRef[i];
-                continue;
-            }
-
-            // if spatial constraint is specified
-            if (!targetIndexes->segments.empty())
-            {
-                for (std::map<long, long>::iterator it = startIter; it != targetIndexes->segments.end(); it++)
-                {
-                    if (indexRef[i] > it->first && indexRef[i] <= (it->first + it->second+1))
-                    {
-                        if (start != (it->first)+1)
-                        {
-                            startIter = it;
-                            start = (it->first)+1;
-                            length = it->second;
-                            end = start + length;
-
-                            //Ensure that we do not decrement the iterator
-                            //if it is at the beginning of targetIndexes->segments.begin()
-                            if(it == targetIndexes->segments.begin())
-                                continue;
-
-                            it--;
-                            prevLength = it->second;
-                            diffIndex = true;
-                        }
-                        else diffIndex = false;
-                        break;
-                    }
-                }
-            }
+            offset[0] = it->first;
+            count[0] = it->second;
+            space.selectHyperslab(H5S_SELECT_OR, count, offset);
+        }
+    }
 
-            // first index
-            // calculate offset if first index does not equal to start of the (start, length) pair
-            // in targetIndexes
-            if (prevOldLocation == 0 && startIter == targetIndexes->segments.begin())
-            {
-                location = indexRef[i] - (start-1);
-                if (indexRef[i] != start) offset = indexRef[i] - start;
-            }
-            // anything other than first index
-            // offset = index - previous index
-            // new index = previous new index + offset
-            else
+    /**
+     * get the fill value of an index dataset, from its _FillValue attribute
+     * or its user-defined fill value, -1 (as for ATL10) when it has neither
+     * @param indataset DataSet the input dataset
+     * @return the fill value
+     */
+    static int32_t getFillValue(const H5::DataSet& indataset)
+    {
+        int32_t fillValue = -1;
+        if (indataset.attrExists("_FillValue"))
+        {
+            H5::Attribute attribute = indataset.openAttribute("_FillValue");
+            if (attribute.getSpace().getSimpleExtentNpoints() == 1)
             {
-                offset = indexRef[i] - prevOldLocation;
-                location = prevLocation + offset;
-                // diffIndex - index is in a different (start, length) pair than the previous index reference
-                if (diffIndex)
-                {
-                    offset = indexRef[i] - start;
-                    location = prevLocation + (prevLength - count) + offset;
-                    count = 0;
-                }
+                attribute.read(H5::PredType::NATIVE_INT, &fillValue);
             }
-            newIndexRef[i] = location;
-            count += offset;
-
-            prevLocation = location;
-            prevOldLocation = indexRef[i];
+            return fillValue;
         }
 
-         // write the index dataset
-        int dimnum = indataset.getSpace().getSimpleExtentNdims();
-        hsize_t olddims[dimnum], newdims[dimnum], maxdims[dimnum];
-        indataset.getSpace().getSimpleExtentDims(olddims, maxdims);
-        newdims[0] = subsettedSize;
-        for (int d = 1; d < dimnum; d++) newdims[d] = olddims[d];
-
-        H5::DataSpace outspace(dimnum, newdims, maxdims);
-        H5::DataType datatype(indataset.getDataType());
-        H5::DataSet outdataset(outgroup.createDataSet(datasetName, datatype, outspace, indataset.getCreatePlist()));
-        outdataset.write(newIndexRef, datatype, H5::DataSpace::ALL, outspace);
+        H5::DSetCreatPropList plist = indataset.getCreatePlist();
+        H5D_fill_value_t fillValueStatus;
+        if (H5Pfill_value_defined(plist.getId(), &fillValueStatus) >= 0 && fillValueStatus == H5D_FILL_VALUE_USER_DEFINED)
+        {
+            plist.getFillValue(H5::PredType::NATIVE_INT, &fillValue);
+        }
+        return fillValue;
+    }
 
-        delete [] indexRef;
-        delete [] inData;
-        delete [] newIndexRef;
+    /**
+     * count the selected rows before each row of a group, as a prefix sum of
+     * its index selection, with the count of all selected rows at the end
+     * @param targetIndexes IndexSelection the index selection of the group
+     * @param ranks vector the counts, one more than the rows of the group
+     */
+    static void getRanks(IndexSelection* targetIndexes, std::vector<int32_t>& ranks)
+    {
+        long targetSize = targetIndexes->getMaxSize();
+        std::vector<unsigned char> selected(targetSize, 0);
+        if (targetIndexes->segments.empty())
+        {
+            // if only temporal constraint is specified
+            std::fill(selected.begin() + targetIndexes->minIndexStart, selected.begin() + targetIndexes->maxIndexEnd, 1);
+        }
+        for (std::map<long, long>::iterator it = targetIndexes->segments.begin(); it != targetIndexes->segments.end(); it++)
+        {
+            std::fill(selected.begin() + it->first, selected.begin() + it->first + it->second, 1);
+        }
 
+        ranks.resize(targetSize + 1);
+        ranks[0] = 0;
+        for (long row = 0; row < targetSize; row++) ranks[row + 1] = ranks[row] + selected[row];
     }
 };
 
@@ -8,158 +8,274 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <functional>
+
+#include <boost/filesystem.hpp>
 
 #include "ProcessArguments.h"
 #include "Configuration.h"
+#include "FileImage.h"
 #include "geobox.h"
 #include "SubsetDataLayers.h"
 #include "Subsetter.h"
 #include "IcesatSubsetter.h"
 #include "SuperGroupSubsetter.h"
+#include "SubsetDaemon.h"
+#include "SubsetBatch.h"
 #include "Temporal.h"
 #include "LogLevel.h"
 
 
 /**
- * Trajectory Subsetter main function.
+ * Subset an opened granule to the output described by the processed
+ * arguments, using an already loaded configuration.
+ *
+ * @param processArgs The processed arguments of the subset request.
+ * @param config The configuration.
+ * @param infile The opened input granule.
+ * @param catalog The catalog of the input granule, or NULL to catalog it for this subset.
+ * @return Error code (0 - success, 3 - no match data found, 6 - no polygon found)
  */
-int main(int argc, char* argv[])
+int subsetOpenedGranule(std::shared_ptr<ProcessArguments> processArgs, Configuration* config, const H5::H5File& infile,
+                        H5Catalog* catalog = NULL)
 {
-    clock_t startTime, endTime;
-    startTime=clock();
+    std::string startString = processArgs->getStartString();
+    std::string endString = processArgs->getEndString();
+    std::string datasetList = processArgs->getDatasetList();
+    std::vector<std::string> datasetsToInclude = processArgs->getDatasetsToInclude();
+    std::vector<geobox> *geoboxes = processArgs->getGeoboxes();
+    std::string infilename = processArgs->getInfilename();
+    std::string outfilename = processArgs->getOutfilename();
+    std::string outputFormat = processArgs->getOutputFormat();
+    std::string collShortName = processArgs->getCollShortName();
 
-    // This is the error code returned by Subsetter::subset()
-    // if an exception is not thrown.
-    int ErrorCode = 0;
+    // Data structure for requested datasets.
+    SubsetDataLayers* subsetDataLayers;
 
-    try
+    // Read in a json file if one is provided for the
+    // requested datasets.
+    if (datasetList.find("json") != std::string::npos)
     {
-        // If process_args() returns a non-zero value,
-        // then the arguments were unable to be processed.
-        std::shared_ptr<ProcessArguments> processArgs = std::make_shared<ProcessArguments>();
-        int processArgsErrorCode = processArgs->process_args(argc, argv);
-        if (processArgsErrorCode != ProcessArguments::PASS)
+        subsetDataLayers = new SubsetDataLayers(datasetList);
+    }
+    // Otherwise, read in the datasets specified in the command
+    // line request via --includedatasets.
+    else
+    {
+        std::string dataset;
+        boost::char_separator<char> delim(" ,");
+        boost::tokenizer<boost::char_separator<char> > datasets(datasetList, delim);
+        BOOST_FOREACH(dataset, datasets)
         {
-            return processArgsErrorCode;
+            datasetsToInclude.push_back(dataset);
         }
+        subsetDataLayers = new SubsetDataLayers(datasetsToInclude);
+    }
 
-        std::string startString = processArgs->getStartString();
-        std::string endString = processArgs->getEndString();
-        std::string datasetList = processArgs->getDatasetList();
-        std::vector<std::string> datasetsToInclude = processArgs->getDatasetsToInclude();
-        boost::property_tree::ptree boundingShapePt = processArgs->getBoundingShapePt();
-        std::vector<geobox> *geoboxes = processArgs->getGeoboxes();
-        std::string infilename = processArgs->getInfilename();
-        std::string outfilename = processArgs->getOutfilename();
-        std::string outputFormat = processArgs->getOutputFormat();
-        std::string collShortName = processArgs->getCollShortName();
+    // Construct test to check if the input start and end parameters
+    // are valid, if they are specified.
+    Temporal* temporal = (!startString.empty() && !endString.empty())?
+                         new Temporal(startString, endString) : NULL;
 
-        Configuration* config = new Configuration(processArgs->getConfigFile());
+    // The bounding shape info, if specified, read with the arguments.
+    GeoPolygon* geoPolygon = processArgs->getGeoPolygon();
+
+    // If a bounding shape is provided but the constructed GeoPolygon
+    // polygon contains no data, return an error.
+    if (geoPolygon != NULL and geoPolygon->isEmpty())
+    {
+        LOG_ERROR("Subset::main(): ERROR: no polygon found for the given GeoJSON/KML/Shapefile");
+        return 6;
+    }
 
-        // Data structure for requested datasets.
-        SubsetDataLayers* subsetDataLayers;
+    // Extract the granule mission by passing the short name returned by
+    // a Subsetter class function into a Configuration instance function.
+    Subsetter* getMission = new Subsetter(subsetDataLayers, geoboxes,
+                                          temporal, geoPolygon, config, outputFormat);
 
-        // Read in a json file if one is provided for the
-        // requested datasets.
-        if (datasetList.find("json") != std::string::npos)
-        {
-            subsetDataLayers = new SubsetDataLayers(datasetList);
-        }
-        // Otherwise, read in the datasets specified in the command
-        // line request via --includedatasets.
-        else
-        {
-            std::string dataset;
-            boost::char_separator<char> delim(" ,");
-            boost::tokenizer<boost::char_separator<char> > datasets(datasetList, delim);
-            BOOST_FOREACH(dataset, datasets)
-            {
-                datasetsToInclude.push_back(dataset);
-            }
-            subsetDataLayers = new SubsetDataLayers(datasetsToInclude);
-        }
+    std::string shortname = getMission->retrieveShortName(infile);
 
-        // Construct test to check if the input start and end parameters
-        // are valid, if they are specified.
-        Temporal* temporal = (!startString.empty() && !endString.empty())?
-                             new Temporal(startString, endString) : NULL;
+    if(shortname.empty() && !collShortName.empty())
+    {
+        shortname = collShortName;
+        LOG_INFO("Subset::main(): shortname: " << shortname);
+    }
+    else if (shortname.empty() && collShortName.empty())
+    {
+        LOG_ERROR("Subset::main(): ERROR: The short name could not be retrieved \
+                    from the collection or was not defined in the command line arguments");
+    }
 
-        // Construct data structure to hold bounding shape info, if specified.
-        GeoPolygon* geoPolygon = (!boundingShapePt.empty())? new GeoPolygon(boundingShapePt) : NULL;
+    std::string mission = config->getMissionFromShortName(shortname);
+    delete getMission;
 
-        // If a bounding shape is provided but the constructed GeoPolygon
-        // polygon contains no data, return an error.
-        if (geoPolygon != NULL and geoPolygon->isEmpty())
-        {
-            LOG_ERROR("Subset::main(): ERROR: no polygon found for the given GeoJSON/KML/Shapefile");
-            return 6;
-        }
+    // Select which subsetter is needed for the mission.
+    Subsetter* subsetter = nullptr;
+    if (mission == "ICESAT")
+    {
+        subsetter = new IcesatSubsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+    }
+    else if (mission == "GEDI")
+    {
+        subsetter = new SuperGroupSubsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+    }
+    else // Use the base Subsetter if the mission isn't GEDI or ICESAT.
+    {
+        subsetter = new Subsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config, outputFormat);
+    }
+    subsetter->setCopyFileRange(processArgs->isCopyFileRange());
+    subsetter->setEstimate(processArgs->isEstimate());
+    subsetter->setInMemoryOutputCap((hsize_t)processArgs->getInMemoryOutputCapMB() * 1024 * 1024);
+    subsetter->setCatalog(catalog);
+    int ErrorCode = subsetter->subset(infile, infilename, outfilename, shortname);
+    if (ErrorCode == 0)
+        LOG_INFO("Subset::main(): subset SUCCESS");
+    else
+        LOG_ERROR("Subset::main(): subset FAILED return code: " << ErrorCode);
 
-        // Extract the granule mission by passing the short name returned by
-        // a Subsetter class function into a Configuration instance function.
-        Subsetter* getMission = new Subsetter(subsetDataLayers, geoboxes,
-                                              temporal, geoPolygon, config, outputFormat);
-        H5::H5File infile = H5::H5File(infilename,H5F_ACC_RDONLY);
+    // Release dynamic memory.
+    delete subsetDataLayers;
+    if (temporal != NULL)
+    {
+        delete temporal;
+    }
+    delete subsetter;
 
-        std::string shortname = getMission->retrieveShortName(infile);
+    return ErrorCode;
+}
 
-        if(shortname.empty() && !collShortName.empty())
-        {
-            shortname = collShortName;
-            LOG_INFO("Subset::main(): shortname: " << shortname);
-        }
-        else if (shortname.empty() && collShortName.empty())
-        {
-            LOG_ERROR("Subset::main(): ERROR: The short name could not be retrieved \
-                        from the collection or was not defined in the command line arguments");
-        }
 
-        std::string mission = config->getMissionFromShortName(shortname);
-        delete getMission;
+/**
+ * Subset a single granule described by the processed arguments, using an
+ * already loaded configuration.
+ *
+ * When named regions are requested, the granule is opened and cataloged once
+ * and each region is subset from it to its own output, reading each
+ * coordinate once.
+ *
+ * @param processArgs The processed arguments of the subset request.
+ * @param config The configuration.
+ * @return Error code (0 - success, 3 - no match data found, 6 - no polygon found),
+ *         for regions the last error code of a region that failed.
+ */
+int subsetGranule(std::shared_ptr<ProcessArguments> processArgs, Configuration* config)
+{
+    // Open the input granule, either from disk or from an in-memory
+    // file image that must stay mapped until the subset is done.
+    std::shared_ptr<FileImage> inputImage;
+    if (processArgs->getInputFd() >= 0)
+    {
+        inputImage = std::make_shared<FileImage>(processArgs->getInputFd());
+    }
+    else if (processArgs->isFileImage())
+    {
+        inputImage = std::make_shared<FileImage>(processArgs->getInfilename());
+    }
+    H5::H5File infile = (inputImage)? inputImage->open() : H5::H5File(processArgs->getInfilename(), H5F_ACC_RDONLY);
 
-        // Select which subsetter is needed for the mission.
-        Subsetter* subsetter = nullptr;
-        if (mission == "ICESAT")
-        {
-            subsetter = new IcesatSubsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config);
-        }
-        else if (mission == "GEDI")
-        {
-            subsetter = new SuperGroupSubsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config);
-        }
-        else // Use the base Subsetter if the mission isn't GEDI or ICESAT.
-        {
-            subsetter = new Subsetter(subsetDataLayers, geoboxes, temporal, geoPolygon, config, outputFormat);
-        }
-        ErrorCode = subsetter->subset(infilename, outfilename, shortname);
-        if (ErrorCode == 0)
-            LOG_INFO("Subset::main(): subset SUCCESS");
-        else
-            LOG_ERROR("Subset::main(): subset FAILED return code: " << ErrorCode);
+    if (processArgs->getRegionCount() == 0)
+    {
+        return subsetOpenedGranule(processArgs, config, infile);
+    }
 
-        // Release dynamic memory.
-        delete config;
-        delete subsetDataLayers;
-        if (temporal != NULL)
+    int ErrorCode = 0;
+    H5Catalog catalog(infile);
+    Coordinate::shareCoordinateValues(true);
+    for (size_t region = 0; region < processArgs->getRegionCount(); region++)
+    {
+        std::shared_ptr<ProcessArguments> regionArgs;
+        int regionErrorCode = processArgs->getRegionArguments(region, regionArgs);
+        if (regionErrorCode == ProcessArguments::PASS)
         {
-            delete temporal;
+            // Each region computes its own index selections.
+            Coordinate::resetLookUp();
+            regionErrorCode = subsetOpenedGranule(regionArgs, config, infile, &catalog);
         }
-        if (geoPolygon != NULL)
+        if (regionErrorCode != 0)
         {
-           delete geoPolygon;
+            ErrorCode = regionErrorCode;
         }
-        delete subsetter;
+    }
+    Coordinate::shareCoordinateValues(false);
+
+    return ErrorCode;
+}
+
+
+/**
+ * Log the arguments and run time of a subset request.
+ */
+void logRequest(int argc, char* argv[], clock_t startTime)
+{
+    std::stringstream argvStream;
+    for (int i = 0; i < argc; i++)
+    {
+        argvStream << argv[i] <<  " ";
+    }
+    LOG_INFO(argvStream.str());
+
+    clock_t endTime=clock();
+    double runTime = (double) (endTime - startTime) / CLOCKS_PER_SEC;
+    LOG_INFO(" execution time: " << runTime << " seconds");
+}
+
+
+/**
+ * Subset one request received by the daemon, or one job of a batch manifest.
+ *
+ * Requests use the configuration of the daemon or batch. A request naming
+ * another configuration file is rejected rather than subset with the wrong
+ * product rules.
+ *
+ * @param argc The number of request arguments.
+ * @param argv The request arguments, in command line form.
+ * @param config The configuration loaded by the daemon or batch.
+ * @param configFile The file the configuration was loaded from.
+ * @return Error code, as returned by the command line invocation.
+ */
+int subsetRequest(int argc, char* argv[], Configuration* config, const std::string& configFile)
+{
+    clock_t startTime=clock();
+
+    std::shared_ptr<ProcessArguments> processArgs = std::make_shared<ProcessArguments>();
+    int processArgsErrorCode = processArgs->process_args(argc, argv);
+    if (processArgsErrorCode != ProcessArguments::PASS)
+    {
+        return processArgsErrorCode;
+    }
+    if (!processArgs->getDaemonSocket().empty() || !processArgs->getManifest().empty())
+    {
+        LOG_ERROR("Subset::subsetRequest(): ERROR: a request can not start a daemon or batch");
+        return ProcessArguments::ERROR;
+    }
+
+    std::string requestConfigFile = processArgs->getConfigFile();
+    boost::system::error_code error;
+    if (!requestConfigFile.empty() && requestConfigFile != configFile &&
+        !boost::filesystem::equivalent(requestConfigFile, configFile, error))
+    {
+        LOG_ERROR("Subset::subsetRequest(): ERROR: the request configuration " << requestConfigFile
+                  << " is not the configuration " << configFile << " loaded for all requests");
+        return ProcessArguments::ERROR;
+    }
+
+    int ErrorCode = subsetGranule(processArgs, config);
+    logRequest(argc, argv, startTime);
+    return ErrorCode;
+}
 
-        std::stringstream argvStream;
-        for (int i = 0; i < argc; i++)
-        {
-            argvStream << argv[i] <<  " ";
-        }
-        LOG_INFO(argvStream.str());
 
-        endTime=clock();
-        double runTime = (double) (endTime - startTime) / CLOCKS_PER_SEC;
-        LOG_INFO(" execution time: " << runTime << " seconds");
+/**
+ * Run a subset, converting any exception into the error code -1.
+ *
+ * @param subsetFunction The subset to run.
+ * @return The error code of the subset, or -1 if an exception was caught.
+ */
+int runSubset(const std::function<int()>& subsetFunction)
+{
+    try
+    {
+        return subsetFunction();
     }
     catch (H5::Exception e)
     {
@@ -187,5 +303,63 @@ int main(int argc, char* argv[])
         LOG_ERROR("\nSubset::main(): ERROR: unknown exception occurred");
         return -1;
     }
-    return ErrorCode;
- }
+}
+
+
+/**
+ * Trajectory Subsetter main function.
+ */
+int main(int argc, char* argv[])
+{
+    clock_t startTime=clock();
+
+    return runSubset([&]() -> int
+    {
+        // If process_args() returns a non-zero value,
+        // then the arguments were unable to be processed.
+        std::shared_ptr<ProcessArguments> processArgs = std::make_shared<ProcessArguments>();
+        int processArgsErrorCode = processArgs->process_args(argc, argv);
+        if (processArgsErrorCode != ProcessArguments::PASS)
+        {
+            return processArgsErrorCode;
+        }
+
+        Configuration* config = new Configuration(processArgs->getConfigFile());
+
+        // This is the error code returned by Subsetter::subset()
+        // if an exception is not thrown.
+        int ErrorCode = 0;
+
+        if (!processArgs->getDaemonSocket().empty())
+        {
+            // Keep the configuration loaded and subset each request
+            // received on the socket in its own process.
+            SubsetDaemon daemon(processArgs->getDaemonSocket(), processArgs->getMaxJobs());
+            std::string configFile = processArgs->getConfigFile();
+            ErrorCode = daemon.serve([config, configFile](int requestArgc, char* requestArgv[])
+            {
+                return runSubset([&]() -> int { return subsetRequest(requestArgc, requestArgv, config, configFile); });
+            });
+        }
+        else if (!processArgs->getManifest().empty())
+        {
+            // Subset every job of the manifest with the same configuration,
+            // each in its own process.
+            SubsetBatch batch(processArgs->getManifest(), processArgs->getMaxJobs(),
+                              (hsize_t)processArgs->getMemoryBudgetMB() * 1024 * 1024);
+            std::string configFile = processArgs->getConfigFile();
+            ErrorCode = batch.run([config, configFile](int jobArgc, char* jobArgv[])
+            {
+                return runSubset([&]() -> int { return subsetRequest(jobArgc, jobArgv, config, configFile); });
+            });
+        }
+        else
+        {
+            ErrorCode = subsetGranule(processArgs, config);
+        }
+
+        delete config;
+        logRequest(argc, argv, startTime);
+        return ErrorCode;
+    });
+}
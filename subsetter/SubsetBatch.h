@@ -0,0 +1,341 @@
+#ifndef SUBSETBATCH_H
+#define SUBSETBATCH_H
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "H5Cpp.h"
+#include "LogLevel.h"
+#include "SubsetDaemon.h"
+
+
+/**
+ * This class subsets every job of a manifest with a single invocation, so a
+ * reprocessing campaign pays the process start-up and configuration parsing
+ * once rather than once per granule.
+ *
+ * The manifest holds one job per line, in the same JSON form as a daemon
+ * request, for example:
+ *
+ *     {"filename": "in.h5", "outfile": "out.h5", "bbox": ["-10,40,10,50"], "logfile": "out.log"}
+ *
+ * Jobs are started in manifest order, each in a forked process so the
+ * Coordinate::lookUpMap, the configuration's granule cache and the log
+ * output (e.g. a per-job "logfile") belong to that job alone. At most
+ * maxJobs run at once, and with a memory budget, a job is only admitted
+ * while the estimated memory of the running jobs stays within it. A job
+ * whose input granule can not be read for the estimate fails without
+ * being run. Jobs use the configuration of the batch, as daemon requests
+ * use the daemon's.
+ */
+class SubsetBatch
+{
+public:
+
+    /**
+     * @param manifest The manifest file name.
+     * @param maxJobs The maximum number of jobs run at once
+     *                (0 uses the number of hardware threads).
+     * @param memoryBudget The memory the running jobs may use, in bytes
+     *                     (0 for no limit).
+     */
+    SubsetBatch(const std::string& manifest, unsigned int maxJobs = 0, hsize_t memoryBudget = 0)
+    : manifest(manifest), maxJobs(maxJobs), memoryBudget(memoryBudget), memoryInUse(0), failedJobs(0)
+    {
+        if (this->maxJobs == 0)
+        {
+            this->maxJobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    /**
+     * @brief Run every job of the manifest.
+     *
+     * @param handler The function that subsets a single job.
+     * @return 0 if every job succeeded, 1 otherwise.
+     */
+    int run(SubsetDaemon::RequestHandler handler)
+    {
+        std::ifstream manifestStream(manifest.c_str());
+        if (!manifestStream.is_open())
+        {
+            LOG_ERROR("SubsetBatch::run(): ERROR: unable to open manifest " << manifest);
+            return 1;
+        }
+
+        LOG_INFO("SubsetBatch::run(): running " << manifest << " with up to " << maxJobs << " concurrent jobs");
+        std::string job;
+        int lineNumber = 0, jobCount = 0;
+        while (std::getline(manifestStream, job))
+        {
+            lineNumber++;
+            if (job.find_first_not_of(" \t\r") == std::string::npos) continue;
+            jobCount++;
+
+            std::vector<std::string> arguments;
+            try
+            {
+                arguments = SubsetDaemon::requestToArguments(job);
+            }
+            catch (const boost::property_tree::json_parser::json_parser_error &e)
+            {
+                LOG_ERROR("SubsetBatch::run(): ERROR: manifest line " << lineNumber << ": " << e.what());
+                failedJobs++;
+                continue;
+            }
+
+            // the granules are only opened for an estimate when there is
+            // a budget to check it against
+            hsize_t estimate = 0;
+            if (memoryBudget > 0 && !estimateMemory(arguments, estimate))
+            {
+                LOG_ERROR("SubsetBatch::run(): ERROR: manifest line " << lineNumber
+                          << ": unable to read the input granule for its memory estimate");
+                failedJobs++;
+                continue;
+            }
+            admit(estimate);
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                int status = runJob(arguments, handler);
+
+                // _exit() skips the library's exit handlers, so close any
+                // HDF5 objects the job left open to flush its output.
+                H5close();
+                _exit(status & 0xff);
+            }
+            else if (pid < 0)
+            {
+                LOG_ERROR("SubsetBatch::run(): ERROR: fork failed for manifest line " << lineNumber << ": " << strerror(errno));
+                failedJobs++;
+                continue;
+            }
+
+            runningJobs[pid] = RunningJob(lineNumber, estimate);
+            memoryInUse += estimate;
+        }
+
+        while (!runningJobs.empty())
+        {
+            reapJob();
+        }
+
+        LOG_INFO("SubsetBatch::run(): " << jobCount << " jobs finished, " << failedJobs << " failed");
+        return (failedJobs == 0)? 0 : 1;
+    }
+
+    /**
+     * @brief Estimate the memory needed to subset a granule.
+     *
+     *        The subsetter reads whole datasets, and keeps the coordinates
+     *        and index selections of every group until the output is
+     *        written, so the uncompressed size of the input datasets bounds
+     *        its memory.
+     *
+     * @param filename The input granule.
+     * @param estimate The estimated memory in bytes.
+     * @return false if the granule can not be read.
+     */
+    static bool estimateMemory(const std::string& filename, hsize_t& estimate)
+    {
+        estimate = 0;
+        hid_t infile;
+        H5E_BEGIN_TRY
+        {
+            infile = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        }
+        H5E_END_TRY;
+        if (infile < 0)
+        {
+            LOG_WARNING("SubsetBatch::estimateMemory(): unable to open " << filename);
+            return false;
+        }
+
+        H5Lvisit(infile, H5_INDEX_NAME, H5_ITER_NATIVE, SubsetBatch::addDatasetSize, &estimate);
+        H5Fclose(infile);
+        LOG_DEBUG("SubsetBatch::estimateMemory(): " << filename << ": " << estimate << " bytes");
+        return true;
+    }
+
+    /**
+     * @brief Estimate the memory needed to subset a granule read as a file
+     *        image from an open file descriptor.
+     *
+     *        The granule is mapped into memory whole, so its size is taken
+     *        as the estimate, without opening it.
+     *
+     * @param fd The file descriptor, as given to --inputfd.
+     * @param estimate The estimated memory in bytes.
+     * @return false if the descriptor is not an open file.
+     */
+    static bool estimateFileImageMemory(const std::string& fd, hsize_t& estimate)
+    {
+        estimate = 0;
+        char* end;
+        long descriptor = strtol(fd.c_str(), &end, 10);
+        struct stat status;
+        if (fd.empty() || *end != '\0' || descriptor < 0 || fstat(descriptor, &status) != 0)
+        {
+            LOG_WARNING("SubsetBatch::estimateFileImageMemory(): unable to stat file descriptor " << fd);
+            return false;
+        }
+
+        estimate = status.st_size;
+        LOG_DEBUG("SubsetBatch::estimateFileImageMemory(): file descriptor " << fd << ": " << estimate << " bytes");
+        return true;
+    }
+
+private:
+
+    struct RunningJob
+    {
+        int lineNumber;
+        hsize_t estimate;
+        RunningJob(int lineNumber = 0, hsize_t estimate = 0) : lineNumber(lineNumber), estimate(estimate) {}
+    };
+
+    std::string manifest;
+    unsigned int maxJobs;
+    hsize_t memoryBudget;
+    hsize_t memoryInUse;
+    int failedJobs;
+
+    // running job processes, by process id
+    std::map<pid_t, RunningJob> runningJobs;
+
+    /**
+     * @brief Wait until a job fits within the job and memory limits.
+     *
+     *        A job larger than the whole budget runs once no other job does.
+     *
+     * @param estimate The estimated memory of the job.
+     */
+    void admit(hsize_t estimate)
+    {
+        while (!runningJobs.empty() &&
+               (runningJobs.size() >= maxJobs || (memoryBudget > 0 && memoryInUse + estimate > memoryBudget)))
+        {
+            reapJob();
+        }
+        if (memoryBudget > 0 && estimate > memoryBudget)
+        {
+            LOG_WARNING("SubsetBatch::admit(): job needs an estimated " << estimate
+                        << " bytes, more than the memory budget, running it alone");
+        }
+    }
+
+    /**
+     * @brief Wait for a job to finish and record its result.
+     */
+    void reapJob()
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR) return;
+            LOG_ERROR("SubsetBatch::reapJob(): ERROR: waitpid failed: " << strerror(errno));
+            failedJobs += runningJobs.size();
+            runningJobs.clear();
+            memoryInUse = 0;
+            return;
+        }
+
+        std::map<pid_t, RunningJob>::iterator job = runningJobs.find(pid);
+        if (job == runningJobs.end()) return;
+
+        // Exit statuses are unsigned, so -1 arrives as 255.
+        int result = WIFEXITED(status)? (signed char)WEXITSTATUS(status) : -1;
+        if (WIFSIGNALED(status))
+        {
+            LOG_ERROR("SubsetBatch::reapJob(): ERROR: manifest line " << job->second.lineNumber
+                      << " terminated by signal " << WTERMSIG(status));
+        }
+        else if (result != 0)
+        {
+            LOG_ERROR("SubsetBatch::reapJob(): manifest line " << job->second.lineNumber << " FAILED return code: " << result);
+        }
+        else
+        {
+            LOG_INFO("SubsetBatch::reapJob(): manifest line " << job->second.lineNumber << " SUCCESS");
+        }
+        if (result != 0) failedJobs++;
+
+        memoryInUse -= job->second.estimate;
+        runningJobs.erase(job);
+    }
+
+    /**
+     * @brief Estimate the memory of a job from its --filename or --inputfd
+     *        argument.
+     *
+     * @return false if the input granule can not be read. A job without
+     *         an input is estimated at 0, and reports its own usage error.
+     */
+    static bool estimateMemory(const std::vector<std::string>& arguments, hsize_t& estimate)
+    {
+        estimate = 0;
+        for (size_t i = 1; i + 1 < arguments.size(); i++)
+        {
+            if (arguments[i] == "--filename") return estimateMemory(arguments[i+1], estimate);
+            if (arguments[i] == "--inputfd") return estimateFileImageMemory(arguments[i+1], estimate);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Subset one job in the job process.
+     */
+    static int runJob(std::vector<std::string>& arguments, SubsetDaemon::RequestHandler handler)
+    {
+        std::vector<char*> argv;
+        for (std::vector<std::string>::iterator it = arguments.begin(); it != arguments.end(); it++)
+        {
+            argv.push_back(const_cast<char*>(it->c_str()));
+        }
+        return handler(argv.size(), argv.data());
+    }
+
+    /**
+     * @brief H5Lvisit callback adding the uncompressed size of each dataset.
+     */
+    static herr_t addDatasetSize(hid_t root, const char* name, const H5L_info_t* info, void* estimate)
+    {
+        if (info->type != H5L_TYPE_HARD) return 0;
+
+        hid_t object = H5Oopen(root, name, H5P_DEFAULT);
+        if (object < 0) return 0;
+        if (H5Iget_type(object) == H5I_DATASET)
+        {
+            hid_t space = H5Dget_space(object);
+            hid_t type = H5Dget_type(object);
+            hssize_t points = H5Sget_simple_extent_npoints(space);
+            if (points > 0)
+            {
+                *(hsize_t*)estimate += (hsize_t)points * H5Tget_size(type);
+            }
+            H5Tclose(type);
+            H5Sclose(space);
+        }
+        H5Oclose(object);
+        return 0;
+    }
+
+};
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef SUBSETDAEMON_H
+#define SUBSETDAEMON_H
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "H5Cpp.h"
+#include "LogLevel.h"
+#include "ProcessArguments.h"
+
+
+/**
+ * This class serves subset requests over a UNIX domain socket, so the
+ * process start-up, HDF5 initialization and configuration parsing are paid
+ * once rather than once per granule.
+ *
+ * Each connection carries one request: a JSON object whose keys are the
+ * command line options (without the leading "--") and whose values are
+ * strings, arrays of strings for repeatable options such as "bbox", or true
+ * for flags. For example:
+ *
+ *     {"filename": "in.h5", "outfile": "out.h5", "bbox": ["-10,40,10,50"]}
+ *
+ * The reply is a JSON object holding the same return code the command line
+ * invocation would exit with, e.g. {"status": 0}.
+ *
+ * Requests are subset with the configuration the daemon was started with. A
+ * request may repeat its "configfile", but one naming another configuration
+ * file is rejected.
+ *
+ * Every request is handled in a forked child process. The child inherits the
+ * warm state of the daemon (the parsed configuration and initialized HDF5
+ * library) but nothing it does, such as filling the Coordinate::lookUpMap
+ * or the configuration's granule cache, outlives the request.
+ */
+class SubsetDaemon
+{
+public:
+
+    // handler that subsets one request given command line style arguments
+    typedef std::function<int(int argc, char* argv[])> RequestHandler;
+
+    /**
+     * @param socketPath The UNIX domain socket path to listen on.
+     * @param maxJobs The maximum number of requests handled at once
+     *                (0 uses the number of hardware threads).
+     */
+    SubsetDaemon(const std::string& socketPath, unsigned int maxJobs = 0)
+    : socketPath(socketPath), maxJobs(maxJobs), runningJobs(0)
+    {
+        if (this->maxJobs == 0)
+        {
+            this->maxJobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    /**
+     * @brief Accept and handle requests until SIGINT or SIGTERM is received.
+     *
+     * @param handler The function that subsets a single request.
+     * @return 0 on a clean shutdown, -1 if the socket could not be set up.
+     */
+    int serve(RequestHandler handler)
+    {
+        int listenFd = openSocket();
+        if (listenFd < 0)
+        {
+            return -1;
+        }
+
+        // Let accept() return on a shutdown request rather than restarting.
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = SubsetDaemon::requestShutdown;
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        signal(SIGPIPE, SIG_IGN);
+
+        LOG_INFO("SubsetDaemon::serve(): listening on " << socketPath << " with up to " << maxJobs << " concurrent requests");
+        while (!shutdownRequested())
+        {
+            reapJobs(runningJobs >= maxJobs);
+
+            int connectionFd = accept(listenFd, NULL, NULL);
+            if (connectionFd < 0)
+            {
+                if (errno != EINTR)
+                {
+                    LOG_ERROR("SubsetDaemon::serve(): accept failed: " << strerror(errno));
+                }
+                continue;
+            }
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(listenFd);
+                handleRequest(connectionFd, handler);
+                close(connectionFd);
+                _exit(0);
+            }
+            else if (pid < 0)
+            {
+                LOG_ERROR("SubsetDaemon::serve(): fork failed: " << strerror(errno));
+                sendStatus(connectionFd, -1);
+            }
+            else
+            {
+                runningJobs++;
+            }
+            close(connectionFd);
+        }
+
+        LOG_INFO("SubsetDaemon::serve(): shutting down, waiting for " << runningJobs << " requests");
+        close(listenFd);
+        unlink(socketPath.c_str());
+        while (runningJobs > 0)
+        {
+            reapJobs(true);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Convert a JSON request into command line style arguments.
+     *
+     * @param request The JSON request.
+     * @return The arguments, starting with a program name.
+     */
+    static std::vector<std::string> requestToArguments(const std::string& request)
+    {
+        boost::property_tree::ptree requestPt;
+        std::stringstream requestStream(request);
+        boost::property_tree::read_json(requestStream, requestPt);
+        return ProcessArguments::requestToArguments(requestPt);
+    }
+
+private:
+
+    std::string socketPath;
+    unsigned int maxJobs;
+    unsigned int runningJobs;
+
+    // largest request accepted, which bounds inline bounding shapes
+    static constexpr size_t MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+
+    static volatile sig_atomic_t& shutdownFlag()
+    {
+        static volatile sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    static void requestShutdown(int) { shutdownFlag() = 1; }
+
+    static bool shutdownRequested() { return shutdownFlag() != 0; }
+
+    /**
+     * @brief Create, bind and listen on the daemon socket, replacing a stale one.
+     *
+     * @return The listening socket, or -1 on failure.
+     */
+    int openSocket()
+    {
+        struct sockaddr_un address;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            LOG_ERROR("SubsetDaemon::openSocket(): socket path is too long: " << socketPath);
+            return -1;
+        }
+
+        int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0)
+        {
+            LOG_ERROR("SubsetDaemon::openSocket(): unable to create socket: " << strerror(errno));
+            return -1;
+        }
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socketPath.c_str());
+        if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, SOMAXCONN) != 0)
+        {
+            LOG_ERROR("SubsetDaemon::openSocket(): unable to listen on " << socketPath << ": " << strerror(errno));
+            close(listenFd);
+            return -1;
+        }
+        return listenFd;
+    }
+
+    /**
+     * @brief Collect finished request processes.
+     *
+     * @param block Wait for at least one process to finish.
+     */
+    void reapJobs(bool block)
+    {
+        int status;
+        pid_t pid;
+        while (runningJobs > 0 && (pid = waitpid(-1, &status, block ? 0 : WNOHANG)) != 0)
+        {
+            if (pid < 0)
+            {
+                if (errno == EINTR) continue;
+                runningJobs = 0;
+                break;
+            }
+            runningJobs--;
+            if (WIFSIGNALED(status))
+            {
+                LOG_ERROR("SubsetDaemon::reapJobs(): request process " << pid << " terminated by signal " << WTERMSIG(status));
+            }
+            block = false;
+        }
+    }
+
+    /**
+     * @brief Read one request from a connection, subset it and reply with the status.
+     *
+     * @param connectionFd The client connection.
+     * @param handler The function that subsets a single request.
+     */
+    void handleRequest(int connectionFd, RequestHandler handler)
+    {
+        std::string request;
+        char buffer[65536];
+        ssize_t count;
+        while (request.find('\n') == std::string::npos && request.size() < MAX_REQUEST_SIZE &&
+               (count = read(connectionFd, buffer, sizeof(buffer))) != 0)
+        {
+            if (count < 0)
+            {
+                if (errno == EINTR) continue;
+                break;
+            }
+            request.append(buffer, count);
+        }
+
+        int status;
+        std::vector<std::string> arguments;
+        try
+        {
+            arguments = requestToArguments(request);
+        }
+        catch (const boost::property_tree::json_parser::json_parser_error &e)
+        {
+            LOG_ERROR("SubsetDaemon::handleRequest(): JSON parsing error: " << e.what());
+            sendStatus(connectionFd, 1);
+            return;
+        }
+
+        std::vector<char*> argv;
+        for (std::vector<std::string>::iterator it = arguments.begin(); it != arguments.end(); it++)
+        {
+            argv.push_back(const_cast<char*>(it->c_str()));
+        }
+        status = handler(argv.size(), argv.data());
+
+        // The request process ends with _exit(), which skips the library's
+        // exit handlers, so close any HDF5 objects the request left open to
+        // flush its output before the client is told it is complete.
+        H5close();
+        sendStatus(connectionFd, status);
+    }
+
+    /**
+     * @brief Reply to a request with its return code.
+     */
+    static void sendStatus(int connectionFd, int status)
+    {
+        std::string reply = "{\"status\": " + std::to_string(status) + "}\n";
+        if (write(connectionFd, reply.c_str(), reply.size()) < 0)
+        {
+            LOG_ERROR("SubsetDaemon::sendStatus(): unable to reply: " << strerror(errno));
+        }
+    }
+
+};
+
+#endif
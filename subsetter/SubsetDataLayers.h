@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <map>
 #include <set>
 #include <vector>
 #include <algorithm>
@@ -15,20 +16,44 @@
 #include <boost/tokenizer.hpp>
 #include <boost/foreach.hpp>
 #include <boost/regex.hpp>
+#include "H5Catalog.h"
 #include "LogLevel.h"
 
 namespace property_tree = boost::property_tree;
 
 class SubsetDataLayers{
 
-    // data structure that keeps tracks of datasets to be included in the output
-    // the vector is ordered by the depth of the subset data layer
-    // each set contains strings of specified subset data layers at that depth
-    //    Note: when all datasets are included, first set of the vector would contain "/"
-    //          otherwise, emptyset
-    //    Examples: second set would be all one-level data layers (/1, /2)
-    //              third set would be all two-level data layers(/1/2, /1/3)
-    std::vector< std::set <std::string> > datasets;
+    // a component of a data layer path, e.g. "gt1l" in "/gt1l/heights/"
+    struct PathNode
+    {
+        // child nodes, key: interned component id, value: node index
+        std::map<int, int> children;
+
+        // the data layer path ending at this node, ending with '/'
+        std::string path;
+
+        // set when the data layer ending at this node is included
+        bool included;
+
+        // number of included data layers at or below this node
+        size_t included_count;
+
+        PathNode() : included(false), included_count(0) {}
+    };
+
+    // trie of the data layers to be included in the output, so included,
+    // child included and ancestor included checks take one step per path
+    // component regardless of how many data layers are specified
+    //    Note: nodes[0] is above the first component, which is "" for
+    //          absolute paths, e.g. "/" is the path of nodes[0]'s "" child
+    std::vector<PathNode> nodes;
+
+    // path components interned to ids, key: component, value: id
+    std::map<std::string, int> component_ids;
+
+    // number of data layer depths, as returned by getDatasets()
+    size_t depths;
+
     bool include_all;
 
 public:
@@ -42,6 +67,9 @@ public:
     {
         LOG_DEBUG("SubsetDataLayers::SubsetDataLayers(): ENTER");
 
+        nodes.push_back(PathNode());
+        depths = 0;
+
         // if "includeddataset" is specified, add each dataset to "datasets"
         if (!dataset_to_include.empty())
         {
@@ -77,6 +105,8 @@ public:
     // read-in specified subset data layers from a json file when it is provided
     SubsetDataLayers(std::string json_in_name):json_in_name(json_in_name)
     {
+        nodes.push_back(PathNode());
+        depths = 0;
         include_all = false;
         read_from_json(json_in_name);
         add_dataset("/Metadata/");
@@ -87,36 +117,37 @@ public:
     void expand_all(std::string input_filename)
     {
         H5::H5File infile(input_filename, H5F_ACC_RDONLY);
+        expand_all(infile);
+    }
+
+    // expand the dataset list using an already opened input file
+    void expand_all(const H5::H5File& infile)
+    {
         H5::Group ingroup = infile.openGroup("/");
         expand_group(ingroup, "");
     }
 
+    // expand the dataset list using the catalog of the input file
+    void expand_all(H5Catalog& catalog)
+    {
+        expand_group(catalog, "");
+    }
+
     // check to see if a dataset is one of the datasets to  be included in the output
     bool is_dataset_included(std::string str)
     {
         if (*str.rbegin() != '/') str.push_back('/');
         if (include_all) return true;
 
-
-        std::string ancestor("");
-        size_t next_slash;
-        std::vector < std::set <std::string> >::iterator it = datasets.begin();
-
-        while(it != datasets.end())
+        // the dataset is included if it or any of its ancestors is included
+        int node = 0;
+        size_t start = 0, next_slash;
+        while ((next_slash = str.find('/', start)) != std::string::npos)
         {
-            next_slash = str.find('/', ancestor.size());
-            if (next_slash != std::string::npos)
-            {
-                ancestor = str.substr(0, next_slash+1);
-                if (it->find(ancestor) != it->end()){
-                    return true;
-                }
-                it++;
-            }
-            else
-            {
-                return (it->find(ancestor) != it->end());
-            }
+            node = find_child(node, str.substr(start, next_slash - start));
+            if (node < 0) return false;
+            if (nodes[node].included) return true;
+            start = next_slash + 1;
         }
 
         return false;
@@ -128,20 +159,8 @@ public:
         if (*str.rbegin() != '/') str.push_back('/');
         if (include_all) return true;
 
-        std::vector < std::set <std::string> >::iterator it = datasets.begin();
-
-        while(it != datasets.end())
-        {
-            std::set<std::string>::iterator set_iter = it->begin();
-            while(set_iter!=it->end())
-            {
-                if (set_iter->find(str)==0) return true;
-                set_iter++;
-            }
-            it++;
-        }
-
-        return false;
+        int node = find_node(str);
+        return (node >= 0 && nodes[node].included_count > 0);
     }
 
     // check to see if it is one of the included datasets or any of its children are included in the output
@@ -156,6 +175,7 @@ public:
         LOG_DEBUG("SubsetDataLayers::print_datasets(): printing the subset data layers");
 
         int count = 0;
+        std::vector< std::set <std::string> > datasets = getDatasets();
         std::vector< std::set <std::string> >::iterator it = datasets.begin();
 
         // loop through sets in the vector
@@ -183,6 +203,7 @@ public:
         property_tree::ptree root;
         property_tree::ptree data_set_layers; // list(node) stores included datasets
 
+        std::vector< std::set <std::string> > datasets = getDatasets();
         std::vector< std::set <std::string> >::iterator it = datasets.begin();
 
         // loop through sets in the vector
@@ -213,7 +234,18 @@ public:
         property_tree::write_json(json_out_name, root);
     }
 
-    std::vector < std::set <std::string> > getDatasets() { return this->datasets; }
+    // get the included datasets, ordered by the depth of the subset data layer
+    // each set contains strings of specified subset data layers at that depth
+    //    Note: when all datasets are included, first set of the vector would contain "/"
+    //          otherwise, emptyset
+    //    Examples: second set would be all one-level data layers (/1, /2)
+    //              third set would be all two-level data layers(/1/2, /1/3)
+    std::vector < std::set <std::string> > getDatasets()
+    {
+        std::vector < std::set <std::string> > datasets(depths);
+        collect_datasets(0, 0, datasets);
+        return datasets;
+    }
 
     // add descendants of a group that are included in the output to "datasets"
     // ingroup IN: input h5 group
@@ -244,119 +276,175 @@ public:
         remove_expanded_group(groupName);
     }
 
+    // add descendants of a group that are included in the output to "datasets",
+    // listing the group from the catalog of the input file
+    // catalog IN: input file catalog
+    // groupname IN: group name
+    void expand_group(H5Catalog& catalog, std::string groupName)
+    {
+        const std::vector<H5Catalog::Entry>& objects = catalog.getChildren(groupName + "/");
+        for (std::vector<H5Catalog::Entry>::const_iterator it = objects.begin(); it != objects.end(); it++)
+        {
+            std::string full_name = groupName + "/" + it->name;
+            if (it->type == "group" && is_included(full_name))
+            {
+                expand_group(catalog, full_name);
+            }
+            else if (it->type == "dataset" && is_dataset_included(full_name))
+            {
+                if (*full_name.rbegin() != '/') full_name.push_back('/');
+                add_expanded_dataset(full_name);
+            }
+        }
+        remove_expanded_group(groupName);
+    }
+
 private:
 
     // Add a dataset to "datasets" only if its ancestor is not already included.
     // Purge lower-level datasets if their ancestor is being added.
     void add_dataset(std::string str)
     {
-        std::string ancestor = "";
-        std::set<std::string> empty_set;
-        size_t next_slash;
-
-        if (datasets.size() == 0)
-        {
-            datasets.push_back(empty_set);
-        }
-
-        std::vector< std::set <std::string> >::iterator it = datasets.begin();
-
-        next_slash = str.find('/',1);
-
-        // Step through levels of added dataset string, treating levels as ancestors.
-        // Step down through levels of datasets and exit if ancestor is found.
-        while (next_slash != std::string::npos)
+        std::vector<int> trail;
+        size_t start = 0, next_slash;
+        int node = 0;
+
+        // Step down through the levels of the added dataset string, and exit
+        // if the dataset or one of its ancestors below the top level is
+        // already included.
+        while ((next_slash = str.find('/', start)) != std::string::npos)
         {
-            it++;   // Step down into datasets.
-
-            if (it == datasets.end())
-            {
-                // If no set of variables are found at this level, add an empty
-                // set at this level.
-                // (insert of dataset follows)
-                it = datasets.insert(it, empty_set);
-            }
-
-            // Expand ancestor string to include next level.
-            ancestor = str.substr(0, next_slash+1);
-
-            // Move end-marker to next '/', starting at current end-marker.
-            // Current next_slash == ancestor.size().
-            next_slash = str.find('/', ancestor.size()+1);
-            if (it->find(ancestor) != it->end())
+            node = add_child(node, str.substr(start, next_slash - start));
+            trail.push_back(node);
+            start = next_slash + 1;
+            if (nodes[node].included && (trail.size() > 1 || start == str.size()))
             {
-                // Found the ancestor string in the set at this level (it).
+                depths = std::max(depths, trail.size());
                 return;
             }
         }
-
-        // If full dataset string is not found at this level, insert dataset.
-        if (it->find(str) == it->end())
+        if (trail.empty()) return;
+        depths = std::max(depths, trail.size());
+
+        // Purge any lower-level datasets where the new dataset being added
+        // is an ancestor, then insert the dataset.
+        size_t purged = nodes[node].included_count;
+        purge_children(node);
+        for (std::vector<int>::iterator it = trail.begin(); it != trail.end(); it++)
         {
-            it->insert(str);
-            LOG_DEBUG("SubsetDataLayers::add_dataset(): inserted dataset: " << str);
+            nodes[*it].included_count = nodes[*it].included_count - purged + 1;
+        }
+        nodes[node].included = true;
+        nodes[node].path = str;
+        LOG_DEBUG("SubsetDataLayers::add_dataset(): inserted dataset: " << str);
+    }
 
-            // Skip to the next level, purge any lower-level datasets
-            // where the new dataset being added is an ancestor.
-            it++;
-            while (it != datasets.end())
-            {
-                // Now start iterating through the datasets within the set
-                // at this level.
-                std::set<std::string>::iterator set_iter = it->begin();
-                while(set_iter!=it->end())
-                {
-                    // Look for the new dataset being added as a prefix in any
-                    // of the datasets withing the current set.
-                    if (set_iter->find(str)==0)
-                    {
-                        // Remove the set-item that has matching prefix.
-                        // Compute the parameter set-iter, iterate, and call erase.
-                        it->erase(set_iter++);
-                    }
-                    else
-                    {
-                        set_iter++;
-                    }
+    void add_expanded_dataset(std::string str)
+    {
+        std::vector<int> trail;
+        size_t start = 0, next_slash;
+        int node = 0;
+        while ((next_slash = str.find('/', start)) != std::string::npos)
+        {
+            node = add_child(node, str.substr(start, next_slash - start));
+            trail.push_back(node);
+            start = next_slash + 1;
+        }
+        depths = std::max(depths, trail.size());
 
-                }
-                it++;
-            }
+        if (trail.empty() || nodes[node].included) return;
+        for (std::vector<int>::iterator it = trail.begin(); it != trail.end(); it++)
+        {
+            nodes[*it].included_count++;
         }
+        nodes[node].included = true;
+        nodes[node].path = str;
     }
 
+    // removes groups that has already been expanded
+    void remove_expanded_group(std::string str)
+    {
+        if (*str.rbegin() != '/') str.push_back('/');
+        if (!is_dataset_included(str)) return;
 
+        std::vector<int> trail;
+        size_t start = 0, next_slash;
+        int node = 0;
+        while ((next_slash = str.find('/', start)) != std::string::npos)
+        {
+            node = find_child(node, str.substr(start, next_slash - start));
+            if (node < 0) return;
+            trail.push_back(node);
+            start = next_slash + 1;
+        }
 
-    void add_expanded_dataset(std::string str)
+        if (trail.empty() || !nodes[node].included) return;
+        for (std::vector<int>::iterator it = trail.begin(); it != trail.end(); it++)
+        {
+            nodes[*it].included_count--;
+        }
+        nodes[node].included = false;
+    }
+
+    // get the child of a node for a path component, or -1 if there is none
+    int find_child(int node, const std::string& component)
     {
-        int num_of_slashes = std::count(str.begin(), str.end(), '/');
-        std::set<std::string> s = datasets.back();
-        std::set<std::string> empty_set;
+        std::map<std::string, int>::iterator id = component_ids.find(component);
+        if (id == component_ids.end()) return -1;
+        std::map<int, int>::iterator child = nodes[node].children.find(id->second);
+        return (child == nodes[node].children.end())? -1 : child->second;
+    }
 
-        if (num_of_slashes <= datasets.size())
+    // get the child of a node for a path component, adding it if there is none
+    int add_child(int node, const std::string& component)
+    {
+        std::map<std::string, int>::iterator id = component_ids.find(component);
+        if (id == component_ids.end())
         {
-            datasets.at(num_of_slashes-1).insert(str);
+            id = component_ids.insert(std::make_pair(component, (int)component_ids.size())).first;
         }
-        else
+        std::map<int, int>::iterator child = nodes[node].children.find(id->second);
+        if (child != nodes[node].children.end()) return child->second;
+
+        int index = nodes.size();
+        nodes.push_back(PathNode());
+        nodes[node].children[id->second] = index;
+        return index;
+    }
+
+    // get the node of a path ending with '/', or -1 if it is not in the trie
+    int find_node(const std::string& str)
+    {
+        int node = 0;
+        size_t start = 0, next_slash;
+        while (node >= 0 && (next_slash = str.find('/', start)) != std::string::npos)
         {
-            while (num_of_slashes > datasets.size())
-            {
-                datasets.insert(datasets.end(), empty_set);
-            }
-            datasets.back().insert(str);
+            node = find_child(node, str.substr(start, next_slash - start));
+            start = next_slash + 1;
         }
+        return (node == 0)? -1 : node;
     }
 
-    // removes groups that has already been expanded
-    void remove_expanded_group(std::string str)
+    // exclude every data layer below a node
+    void purge_children(int node)
     {
-        if (*str.rbegin() != '/') str.push_back('/');
-        int num_of_slashes = std::count(str.begin(), str.end(), '/');
-        if (datasets.size() > num_of_slashes-1 && is_dataset_included(str))
+        for (std::map<int, int>::iterator it = nodes[node].children.begin(); it != nodes[node].children.end(); it++)
         {
-            datasets.at(num_of_slashes-1).erase(str);
+            if (nodes[it->second].included_count == 0) continue;
+            nodes[it->second].included = false;
+            nodes[it->second].included_count = 0;
+            purge_children(it->second);
         }
+    }
 
+    // add the included data layers at or below a node to their depth's set
+    void collect_datasets(int node, size_t depth, std::vector < std::set <std::string> >& datasets)
+    {
+        if (nodes[node].included) datasets[depth - 1].insert(nodes[node].path);
+        for (std::map<int, int>::iterator it = nodes[node].children.begin(); it != nodes[node].children.end(); it++)
+        {
+            if (nodes[it->second].included_count > 0) collect_datasets(it->second, depth + 1, datasets);
+        }
     }
 
     // read datasets to be included in the output from a json file
@@ -2,10 +2,14 @@
 #define Subsetter_H
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "H5Cpp.h"
 #include "hdf5_hl.h"
@@ -27,6 +31,7 @@
 #include "ForwardReferenceCoordinates.h"
 #include "HeightSegmentCoordinates.h"
 #include "GeoPolygon.h"
+#include "H5Catalog.h"
 #include "geotiff_converter.h"
 #include "LogLevel.h"
 
@@ -49,11 +54,59 @@ public:
     ~Subsetter()
     {
         delete dimensionScales;
+        if (ownsCatalog) delete catalog;
     }
 
     // configuration information
     Configuration* config;
 
+    /**
+     * @brief Enable or disable kernel-side copies of contiguous datasets.
+     *
+     *        When enabled, unfiltered contiguous datasets are written with a
+     *        contiguous, early-allocated layout and the selected segments are
+     *        copied with copy_file_range(2) from the input file offset to the
+     *        output file offset.
+     *
+     * @param enable True to use copy_file_range for contiguous datasets.
+     */
+    void setCopyFileRange(bool enable) { copyFileRange = enable; }
+
+    /**
+     * @brief Build the output file in memory when the input is small enough.
+     *
+     *        The output is created with the core driver and written to disk
+     *        in one sequential write when it is flushed. Inputs larger than
+     *        the cap, which bound the output size, are written on disk.
+     *
+     * @param capBytes The largest input size, in bytes, to subset in memory
+     *                 (0 disables in-memory output).
+     */
+    void setInMemoryOutputCap(hsize_t capBytes) { inMemoryOutputCap = capBytes; }
+
+    /**
+     * @brief Use an existing catalog of the input granule.
+     *
+     *        The catalog is shared, e.g. between the subsets of several
+     *        regions of one granule, and is not deleted by the subsetter.
+     *        Without one, subset() catalogs the input itself.
+     *
+     * @param inputCatalog The catalog of the granule passed to subset().
+     */
+    void setCatalog(H5Catalog* inputCatalog) { catalog = inputCatalog; }
+
+    /**
+     * @brief Only estimate the subset instead of writing it.
+     *
+     *        subset() then computes the index selections and writes a JSON
+     *        estimate of the output (see writeEstimate) to the output file
+     *        name, or to standard output when it is empty, without creating
+     *        an output granule.
+     *
+     * @param enable True to estimate the subset.
+     */
+    void setEstimate(bool enable) { estimateOnly = enable; }
+
     /**
      * @brief This function performs the subset.
      *
@@ -62,25 +115,33 @@ public:
      * @return Error code (0 - success, 3 - no match data found)
      */
     int subset(std::string infilename, std::string outfilename, std::string collShortName)
+    {
+        // Open the input HDF5 file.
+        LOG_DEBUG("Subsetter::subset(): Opening " << infilename);
+        return subset(H5::H5File( infilename, H5F_ACC_RDONLY ), infilename, outfilename, collShortName);
+    }
+
+    /**
+     * @brief This function performs the subset of an already opened input.
+     *
+     *        The input may be a file image (see FileImage), in which case
+     *        infilename is only used to describe the input in the output.
+     *
+     * @param inputFile The opened input granule.
+     * @param infilename The input granule file path.
+     * @param outfilename The output granule file path.
+     * @return Error code (0 - success, 3 - no match data found)
+     */
+    int subset(const H5::H5File& inputFile, std::string infilename, std::string outfilename, std::string collShortName)
     {
         LOG_DEBUG("Subsetter::subset(): ENTER");
 
         int returnCode = 0;
 
-        // Open the input HDF5 file.
-        LOG_DEBUG("Subsetter::subset(): Opening " << infilename);
-        this->infile = H5::H5File( infilename, H5F_ACC_RDONLY );
+        this->infile = inputFile;
 
-        // Create (or overwrite the existing) output file with
-        // the creation properties of the input file and with
-        // the default access property list of the latest HDF5
-        // library release version.
-        LOG_DEBUG("Subsetter::subset(): Opening " << outfilename);
-        hid_t fileAccessPropList = H5Pcreate(H5P_FILE_ACCESS);
-        H5Pset_libver_bounds(fileAccessPropList, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
-        H5::FileAccPropList fileAccessPropListObj(fileAccessPropList);
-        this->outfile = H5::H5File(outfilename, H5F_ACC_TRUNC, infile.getCreatePlist(), fileAccessPropListObj);
-        H5Pclose(fileAccessPropList);
+        // Catalog the input hierarchy once for all the phases below.
+        Coordinate::CatalogScope catalogScope(&getCatalog());
 
         this->shortName = retrieveShortName(infile);
         if(this->shortName.empty() && !collShortName.empty())
@@ -102,21 +163,68 @@ public:
             this->temporal->updateReferenceTime(epochTime);
         }
 
-        // Open the top level/root group in both in the input and
-        // output file.
         H5::Group ingroup = this->infile.openGroup("/");
+
+        // Describe the selections instead of writing the subset.
+        if (estimateOnly)
+        {
+            return writeEstimate(ingroup, outfilename);
+        }
+
+        // Return before any output is created when the constraints can
+        // not match any data in the granule, judged first from the extent
+        // in its metadata and then from the index selections. The output
+        // file name may have been checked by creating an empty file, which
+        // is removed as it would be after a full subset.
+        if (isOutsideGranuleExtent() || !isMatchingDataPossible(ingroup))
+        {
+            LOG_INFO("Subsetter::subset(): No matching data for the constraints specified. No output file written");
+            remove(outfilename.c_str());
+            return 3;
+        }
+
+        // Create (or overwrite the existing) output file with
+        // the creation properties of the input file and with
+        // the default access property list of the latest HDF5
+        // library release version.
+        LOG_DEBUG("Subsetter::subset(): Opening " << outfilename);
+        hid_t fileAccessPropList = H5Pcreate(H5P_FILE_ACCESS);
+        H5Pset_libver_bounds(fileAccessPropList, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+
+        // Build the output with the core driver when it fits within the
+        // in-memory cap. The image is written to disk in one sequential
+        // write when the file is flushed and closed.
+        // The input size bounds the size of the subset output. The image
+        // grows by a fixed increment, as a subset is usually much smaller
+        // than its input.
+        hsize_t inputFileSize = (inMemoryOutputCap > 0) ? infile.getFileSize() : 0;
+        if (inMemoryOutputCap > 0 && inputFileSize <= inMemoryOutputCap)
+        {
+            LOG_INFO("Subsetter::subset(): Building output in memory (input size " << inputFileSize << " bytes)");
+            H5Pset_fapl_core(fileAccessPropList, CORE_DRIVER_INCREMENT, true);
+        }
+        else if (inMemoryOutputCap > 0)
+        {
+            LOG_INFO("Subsetter::subset(): Input size " << inputFileSize << " bytes exceeds the in-memory cap of "
+                     << inMemoryOutputCap << " bytes, writing output on disk");
+        }
+        H5::FileAccPropList fileAccessPropListObj(fileAccessPropList);
+        this->outfile = H5::H5File(outfilename, H5F_ACC_TRUNC, infile.getCreatePlist(), fileAccessPropListObj);
+        H5Pclose(fileAccessPropList);
+
+        // Open the top level/root group in the output file.
         H5::Group outgroup = this->outfile.openGroup("/");
 
         // Copy the top level/root attributes to the output.
         copyAttributes(ingroup, outgroup, "/");
 
         // Convert and write group and its datasets recursively
-        // to the root group.
+        // to the root group. Groups without spatial coordinates in
+        // requests with only spatial constraints are deferred.
         copyH5(ingroup, ingroup, outgroup, "/");
 
-        // Write subsets for datasets for the special case where
-        // the dataset has no spatial coordinates in requests that
-        // only spatial constraints.
+        // Write the deferred groups, now that the time range of the
+        // spatially subset groups is known.
         writeRequiredTemporalSubsets(ingroup);
 
         // Recreate and re-attach dimension scales in the output file.
@@ -256,12 +364,12 @@ public:
         if (temporal == NULL && (geoboxes != NULL || geoPolygon != NULL))
         {
             // Cycle through every object within the input group.
-            for (int index = 0; index < inputGroup.getNumObjs(); index++)
+            std::vector<H5Catalog::Entry> objects = listObjects(groupName);
+            for (std::vector<H5Catalog::Entry>::iterator object = objects.begin(); object != objects.end(); object++)
             {
-                std::string objectName = inputGroup.getObjnameByIdx(index);
+                std::string objectName = object->name;
                 std::string objectPath = groupName + objectName + "/";
-                std::string typeName = "";
-                inputGroup.getObjTypeByIdx(index, typeName);
+                std::string typeName = object->type;
 
                 // If the object is a group (as opposed to a dataset), is
                 // subsettable, and included in the output, check to see if
@@ -345,7 +453,7 @@ public:
         // Check if infileH5::ingroup request contains subsettable datasets.
         // Expand subsetDataLayers to get all the datasets/groups
         // requested in the input file.
-        subsetDataLayers->expand_group(ingroup, "");
+        subsetDataLayers->expand_all(getCatalog());
         bool inGroupSubsettableDatasetRequested =
                         containsSubsettableDatasets(subsetDataLayers->getDatasets());
 
@@ -509,21 +617,42 @@ protected:
         }
 
         // Construct new dataspace, datatype, list of properties.
-        H5::DataSpace outspace(dimnum, newdims, maxdims);
         H5::DataType datatype(indataset.getDataType());
         H5::DSetCreatPropList plist = indataset.getCreatePlist();
-        if (indataset.getCreatePlist().getLayout() == H5D_CONTIGUOUS && dimnum > 0)
+        bool rawCopy = copyFileRange && isRawCopyable(indataset, dimnum, dim, olddims, newdims);
+        if (rawCopy)
+        {
+            // Keep the contiguous layout and allocate the output storage when
+            // the dataset is created, so its file offset is known up front.
+            // Fill values are never written, as they would otherwise be
+            // buffered by the library and could land on top of the copied bytes.
+            // Contiguous datasets can't be extendible, so the subset dimensions
+            // are also the maximum dimensions.
+            plist.setAllocTime(H5D_ALLOC_TIME_EARLY);
+            plist.setFillTime(H5D_FILL_TIME_NEVER);
+            for (int d = 0; d < dimnum; d++)
+                maxdims[d] = newdims[d];
+        }
+        else if (indataset.getCreatePlist().getLayout() == H5D_CONTIGUOUS && dimnum > 0)
         {
             plist.setLayout(H5D_CHUNKED);
             plist.setChunk(dimnum, olddims);
             plist.setAllocTime(H5D_ALLOC_TIME_INCR);
         }
+        H5::DataSpace outspace(dimnum, newdims, maxdims);
 
         // Construct the new dataset.
         H5::DataSet outdataset(outgroup.createDataSet(objname, datatype, outspace, plist));
         copyAttributes(indataset, outdataset, groupname);
         H5::DataSpace inspace(indataset.getSpace());
 
+        // Move the selected byte ranges between the files without passing
+        // them through user space, falling back to a buffered copy on failure.
+        if (rawCopy && copyContiguousSegments(indataset, outdataset, indexes, dimnum, olddims, newdims))
+        {
+            return;
+        }
+
         // Select the input dataset regions to write to the output dataspace.
 
         // If the output dimensions of the dataset are unchanged, select the entire input dataspace.
@@ -588,8 +717,123 @@ protected:
         return coor;
     }
 
+    /**
+     * @brief Check the constraints against the extent the granule records
+     *        in its own metadata, before any coordinate is read.
+     *
+     *        The attributes or scalar datasets holding the extent of a
+     *        product are configured in "ExtentSources". An extent that is not
+     *        configured, not found or can not be read never rejects the
+     *        granule. Longitudes are not compared when the granule extent
+     *        reaches a pole or either range leaves [-180, 180].
+     *
+     * @return true if the constraints can not match any data in the granule.
+     */
+    bool isOutsideGranuleExtent()
+    {
+        if ((geoboxes == NULL && temporal == NULL && geoPolygon == NULL) || outputFormat == "GeoTIFF")
+        {
+            return false;
+        }
+
+        std::map<std::string, std::string> sources = config->getExtentSources(shortName);
+        if (sources.empty())
+        {
+            return false;
+        }
+
+        // Temporal extent.
+        std::string start, end;
+        boost::posix_time::ptime granuleStart, granuleEnd, requestStart, requestEnd;
+        if (temporal != NULL &&
+            readExtentSource(sources["start"], start) && parseExtentTime(start, granuleStart) &&
+            readExtentSource(sources["end"], end) && parseExtentTime(end, granuleEnd) &&
+            parseExtentTime(temporal->getStartTime(), requestStart) &&
+            parseExtentTime(temporal->getEndTime(), requestEnd) &&
+            (granuleEnd < requestStart || granuleStart > requestEnd))
+        {
+            LOG_INFO("Subsetter::isOutsideGranuleExtent(): granule time range (" << start << ", " << end
+                     << ") is outside the temporal constraint");
+            return true;
+        }
+
+        // Spatial extent.
+        if (geoboxes == NULL && geoPolygon == NULL)
+        {
+            return false;
+        }
+        std::string west, east, south, north;
+        if (!readExtentSource(sources["west"], west) || !readExtentSource(sources["east"], east) ||
+            !readExtentSource(sources["south"], south) || !readExtentSource(sources["north"], north))
+        {
+            return false;
+        }
+        geobox extent(0, 0, 0, 0);
+        try
+        {
+            extent = geobox(boost::lexical_cast<double>(west), boost::lexical_cast<double>(south),
+                            boost::lexical_cast<double>(east), boost::lexical_cast<double>(north));
+        }
+        catch (boost::bad_lexical_cast &e)
+        {
+            LOG_DEBUG("Subsetter::isOutsideGranuleExtent(): unable to read the granule extent: " << e.what());
+            return false;
+        }
+
+        // A match needs one of the bounding boxes, or the bounding shape's
+        // envelope, to overlap the granule extent.
+        std::vector<geobox> requested;
+        if (geoboxes != NULL)
+        {
+            requested = *geoboxes;
+        }
+        if (geoPolygon != NULL)
+        {
+            box_type envelope;
+            boost::geometry::envelope(geoPolygon->polygons, envelope);
+            requested.push_back(geobox(envelope.min_corner().get<0>(), envelope.min_corner().get<1>(),
+                                       envelope.max_corner().get<0>(), envelope.max_corner().get<1>()));
+        }
+        for (std::vector<geobox>::iterator it = requested.begin(); it != requested.end(); it++)
+        {
+            if (isOverlappingExtent(extent, *it))
+            {
+                return false;
+            }
+        }
+
+        LOG_INFO("Subsetter::isOutsideGranuleExtent(): granule extent (" << west << ", " << south << ", "
+                 << east << ", " << north << ") is outside the spatial constraints");
+        return true;
+    }
+
 private:
 
+    /**
+     * @brief Return the catalog of the input hierarchy, cataloging the input
+     *        when no catalog was set.
+     */
+    H5Catalog& getCatalog()
+    {
+        if (catalog == NULL)
+        {
+            catalog = new H5Catalog(infile);
+            ownsCatalog = true;
+        }
+        return *catalog;
+    }
+
+    /**
+     * @brief List the objects of an input group from the catalog.
+     *
+     * @param groupname The name of the group.
+     * @return The name and type of each object in the group.
+     */
+    std::vector<H5Catalog::Entry> listObjects(const std::string& groupname)
+    {
+        return getCatalog().getChildren(groupname);
+    }
+
     /**
      * @brief Subset and write a group and its datasets recursively.
      *
@@ -642,11 +886,12 @@ private:
         // Loop through all the objects in the input group, recursing on
         // groups and copying datasets.
         // Then determine if the group/dataset has been requested.
-        for (int i = 0; i < in.getNumObjs(); i++)
+        std::vector<H5Catalog::Entry> objects = listObjects(groupname);
+        for (size_t i = 0; i < objects.size(); i++)
         {
             std::string type_name, objname;
-            objname = in.getObjnameByIdx(i);
-            in.getObjTypeByIdx(i, type_name);
+            objname = objects[i].name;
+            type_name = objects[i].type;
             std::string objectFullName = groupname + objname;
 
             LOG_DEBUG("Subsetter::copyH5(): " << i << ":" << groupname + objname << ":" << type_name);
@@ -666,6 +911,17 @@ private:
                 }
 
                 copyAttributes(ingroup, outgroup, groupname);
+
+                // A group with only temporal coordinates in a request with
+                // only spatial constraints is subset by the time range of
+                // the spatially subset groups, so it is written once that
+                // range is known.
+                if (requiresTemporalSubsetting(inRootGroup, ingroup, groupname + objname + "/"))
+                {
+                    LOG_DEBUG("Subsetter::copyH5(): deferring " << groupname + objname + "/" << " until the time range is known");
+                    groupsRequiringTemporalSubsetting.push_back(groupname + objname + "/");
+                    continue;
+                }
                 copyH5(ingroup, inRootGroup, outgroup, groupname + objname + "/");
 
                 // Unlink if no object has been copied over.
@@ -796,12 +1052,596 @@ private:
 
     }
 
+    /**
+     * @brief Check whether a bounding box may overlap a granule extent.
+     *
+     * @param extent The granule extent.
+     * @param box The requested bounding box.
+     * @return false only if the box certainly does not overlap the extent.
+     */
+    static bool isOverlappingExtent(geobox& extent, geobox& box)
+    {
+        // Boxes whose south is above their north are not compared.
+        if (extent.getSouth() <= extent.getNorth() && box.getSouth() <= box.getNorth() &&
+            (box.getNorth() < extent.getSouth() - EXTENT_TOLERANCE || box.getSouth() > extent.getNorth() + EXTENT_TOLERANCE))
+        {
+            return false;
+        }
+        if (extent.getNorth() >= 90 || extent.getSouth() <= -90 ||
+            extent.getWest() < -180 || extent.getEast() > 180 || box.getWest() < -180 || box.getEast() > 180)
+        {
+            return true;
+        }
+
+        // Longitude ranges whose west is east of their east cross the
+        // Anti-Meridian, and are split in two.
+        std::vector<std::pair<double, double>> extentRanges, boxRanges;
+        splitLongitudeRange(extent.getWest(), extent.getEast(), extentRanges);
+        splitLongitudeRange(box.getWest(), box.getEast(), boxRanges);
+        for (size_t i = 0; i < extentRanges.size(); i++)
+        {
+            for (size_t j = 0; j < boxRanges.size(); j++)
+            {
+                if (boxRanges[j].first <= extentRanges[i].second + EXTENT_TOLERANCE &&
+                    boxRanges[j].second >= extentRanges[i].first - EXTENT_TOLERANCE)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Split a longitude range crossing the Anti-Meridian in two.
+     */
+    static void splitLongitudeRange(double west, double east, std::vector<std::pair<double, double>>& ranges)
+    {
+        if (west <= east)
+        {
+            ranges.push_back(std::make_pair(west, east));
+        }
+        else
+        {
+            ranges.push_back(std::make_pair(west, 180.0));
+            ranges.push_back(std::make_pair(-180.0, east));
+        }
+    }
+
+    /**
+     * @brief Parse a date time string, e.g. 2018-10-14T00:24:44.622561Z.
+     *
+     * @return false if the string is not a date time.
+     */
+    static bool parseExtentTime(std::string value, boost::posix_time::ptime& time)
+    {
+        replace(value.begin(), value.end(), 'T', ' ');
+        replace(value.begin(), value.end(), 'Z', ' ');
+        try
+        {
+            time = boost::posix_time::time_from_string(value);
+        }
+        catch (std::exception &e)
+        {
+            LOG_DEBUG("Subsetter::parseExtentTime(): unable to parse " << value);
+            return false;
+        }
+        return !time.is_special();
+    }
+
+    /**
+     * @brief Read a granule extent from an attribute or a scalar dataset.
+     *
+     * @param path The path of the attribute (the object path followed by
+     *             the attribute name) or of the dataset.
+     * @param value Out: the extent, as a string.
+     * @return true if the extent was read.
+     */
+    bool readExtentSource(const std::string& path, std::string& value)
+    {
+        size_t slash = path.find_last_of('/');
+        if (path.empty() || slash == std::string::npos || slash == path.size() - 1)
+        {
+            return false;
+        }
+        std::string objectPath = (slash == 0)? "/" : path.substr(0, slash);
+        std::string name = path.substr(slash + 1);
+
+        hid_t attributeId = -1, datasetId = -1;
+        H5E_BEGIN_TRY
+        {
+            if (H5Aexists_by_name(infile.getId(), objectPath.c_str(), name.c_str(), H5P_DEFAULT) > 0)
+            {
+                attributeId = H5Aopen_by_name(infile.getId(), objectPath.c_str(), name.c_str(), H5P_DEFAULT, H5P_DEFAULT);
+            }
+            else if (H5Lexists(infile.getId(), path.c_str(), H5P_DEFAULT) > 0)
+            {
+                datasetId = H5Dopen2(infile.getId(), path.c_str(), H5P_DEFAULT);
+            }
+        }
+        H5E_END_TRY;
+
+        try
+        {
+            if (attributeId >= 0)
+            {
+                H5::Attribute attribute(attributeId);
+                return readExtentValue(attribute, attribute.getDataType(), attribute.getSpace(), value);
+            }
+            if (datasetId >= 0)
+            {
+                H5::DataSet dataset(datasetId);
+                return readExtentValue(dataset, dataset.getDataType(), dataset.getSpace(), value);
+            }
+        }
+        catch (H5::Exception &e)
+        {
+            LOG_DEBUG("Subsetter::readExtentSource(): unable to read " << path << ": " << e.getDetailMsg());
+        }
+        return false;
+    }
+
+    /**
+     * @brief Read a single string or number of an attribute or dataset as a string.
+     */
+    template <class T>
+    static bool readExtentValue(T& object, const H5::DataType& datatype, const H5::DataSpace& space, std::string& value)
+    {
+        if (space.getSimpleExtentNpoints() != 1)
+        {
+            return false;
+        }
+        if (datatype.getClass() == H5T_STRING)
+        {
+            readString(object, datatype, value);
+            return true;
+        }
+        if (datatype.getClass() == H5T_FLOAT || datatype.getClass() == H5T_INTEGER)
+        {
+            double number;
+            readNumber(object, &number);
+            value = boost::lexical_cast<std::string>(number);
+            return true;
+        }
+        return false;
+    }
+
+    static void readString(H5::Attribute& attribute, const H5::DataType& datatype, std::string& value)
+    {
+        attribute.read(datatype, value);
+    }
+
+    static void readString(H5::DataSet& dataset, const H5::DataType& datatype, std::string& value)
+    {
+        dataset.read(value, datatype);
+    }
+
+    static void readNumber(H5::Attribute& attribute, double* number)
+    {
+        attribute.read(H5::PredType::NATIVE_DOUBLE, number);
+    }
+
+    static void readNumber(H5::DataSet& dataset, double* number)
+    {
+        dataset.read(number, H5::PredType::NATIVE_DOUBLE);
+    }
+
+    /**
+     * @brief Check, before the output is created, whether the constraints
+     *        can match any data in the granule.
+     *
+     *        The groups copyH5 would write are visited in the same order,
+     *        computing the same index selections, which stay in the
+     *        Coordinate::lookUpMap for copyH5. The walk stops at the first
+     *        selection that may match. Otherwise the output would hold no
+     *        subsettable dataset, and isMatchingDataFound would reject it,
+     *        unless none of the requested datasets is subsettable.
+     *
+     * @param ingroup The input root group.
+     * @return false if the output would certainly have no matching data.
+     */
+    bool isMatchingDataPossible(H5::Group& ingroup)
+    {
+        LOG_DEBUG("Subsetter::isMatchingDataPossible(): ENTER");
+
+        if ((geoboxes == NULL && temporal == NULL && geoPolygon == NULL) || outputFormat == "GeoTIFF")
+        {
+            return true;
+        }
+
+        bool subsettableDatasetRequested = false;
+        if (findPossibleMatch(ingroup, ingroup, "/", subsettableDatasetRequested))
+        {
+            return true;
+        }
+
+        LOG_DEBUG("Subsetter::isMatchingDataPossible(): every selection is empty, subsettableDatasetRequested: "
+                  << std::boolalpha << subsettableDatasetRequested);
+        return !subsettableDatasetRequested;
+    }
+
+    /**
+     * @brief Look for a selection that may match data in a group, recursively.
+     *
+     *        This mirrors copyH5: datasets without a selection, or whose first
+     *        dimension does not match it, are written whole but are never
+     *        counted as subsettable, and datasets whose selection is empty are
+     *        not written at all.
+     *
+     * @param in The input group.
+     * @param inRootGroup The input root group.
+     * @param groupname The name of the group.
+     * @param subsettableDatasetRequested Set if a requested dataset that is
+     *        not written counts as a subsettable dataset.
+     * @return true if a selection may match data.
+     */
+    bool findPossibleMatch(H5::Group& in, H5::Group& inRootGroup, const std::string& groupname, bool& subsettableDatasetRequested)
+    {
+        std::string metadataGroup = "/METADATA/";
+        bool isMetadataGroup = (boost::to_upper_copy<std::string>(groupname).compare(0, metadataGroup.length(), metadataGroup) == 0);
+
+        IndexSelection* indexes = NULL;
+        if (!isMetadataGroup && config->isGroupSubsettable(shortName, groupname))
+        {
+            Coordinate* coor = getCoordinate(inRootGroup, in, groupname, subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+            indexes = (coor->indexesProcessed)? coor->indexes : coor->getIndexSelection();
+        }
+
+        std::vector<H5Catalog::Entry> objects = listObjects(groupname);
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            std::string objname = objects[i].name;
+            std::string objectFullName = groupname + objname;
+
+            // Cache the objects in the same order as copyH5, which the
+            // granule version depends on.
+            config->addShortNameGroupDatasetFromGranuleFile(shortName, objectFullName + "/");
+
+            if (objects[i].type == "group" && subsetDataLayers->is_included(objectFullName + "/"))
+            {
+                // Groups requiring temporal subsetting take the time range
+                // of the other groups, which is empty when they match nothing.
+                H5::Group ingroup(in.openGroup(objname));
+                if (!requiresTemporalSubsetting(inRootGroup, ingroup, objectFullName + "/") &&
+                    findPossibleMatch(ingroup, inRootGroup, objectFullName + "/", subsettableDatasetRequested))
+                {
+                    return true;
+                }
+            }
+            else if (objects[i].type == "symbolic link" && subsetDataLayers->is_dataset_included(objectFullName))
+            {
+                return true;
+            }
+            else if (objects[i].type == "dataset" && subsetDataLayers->is_dataset_included(objectFullName))
+            {
+                IndexSelection* datasetIndexes = indexes;
+                if (config->isPhotonDataset(shortName, objectFullName))
+                {
+                    Coordinate* coor = getCoordinate(inRootGroup, in, objectFullName, subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+                    datasetIndexes = coor->getIndexSelection();
+                }
+                if (datasetIndexes == NULL) continue;
+
+                const H5Catalog::Entry* dataset = catalog->getDataset(groupname, objname);
+                if (datasetIndexes->size() != 0 || dataset == NULL || dataset->dims.empty())
+                {
+                    return true;
+                }
+                if (!subsettableDatasetRequested && dataset->dims[0] == datasetIndexes->getMaxSize() &&
+                    !isMetadataGroup && count(objectFullName.begin(), objectFullName.end(), '/') > 1 &&
+                    config->isGroupSubsettable(shortName, objectFullName + "/") &&
+                    !H5DSis_scale(in.openDataSet(objname).getId()))
+                {
+                    subsettableDatasetRequested = true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // index selection of a group in an estimate
+    struct GroupEstimate
+    {
+        std::string name;
+        long selectedRows;
+        long totalRows;
+        size_t segments;
+    };
+
+    // projected output of a dataset in an estimate
+    struct DatasetEstimate
+    {
+        std::string name;
+        hsize_t rows;
+        hsize_t bytes;
+        hsize_t chunks;
+    };
+
+    // selections and projected output of a subset, see writeEstimate
+    struct SubsetEstimate
+    {
+        std::vector<GroupEstimate> groups;
+        std::vector<DatasetEstimate> datasets;
+    };
+
+    /**
+     * @brief Estimate the subset without writing it, and write the estimate
+     *        as JSON.
+     *
+     *        The groups copyH5 would write are visited in the same order,
+     *        computing the same index selections, but no dataset is read
+     *        except the time coordinates that bound the groups subset by the
+     *        time range of the others. The estimate holds the size and
+     *        segment count of each group's index selection, the projected
+     *        rows, bytes and input chunks read of each dataset, and their
+     *        totals.
+     *
+     * @param ingroup The input root group.
+     * @param outfilename The JSON file to write, or empty for standard output.
+     * @return Error code (0 - success, 1 - the estimate could not be written)
+     */
+    int writeEstimate(H5::Group& ingroup, const std::string& outfilename)
+    {
+        LOG_DEBUG("Subsetter::writeEstimate(): ENTER");
+
+        SubsetEstimate estimate;
+        estimateGroup(ingroup, ingroup, "/", estimate);
+
+        // Estimate the deferred groups with the time range of the others,
+        // as writeRequiredTemporalSubsets would write them.
+        if (!groupsRequiringTemporalSubsetting.empty())
+        {
+            this->temporal = new Temporal(timeRange.first, timeRange.second);
+            for (std::string groupname : this->groupsRequiringTemporalSubsetting)
+            {
+                Coordinate::lookUpMap.erase(groupname);
+                H5::Group group = this->infile.openGroup(groupname);
+                estimateGroup(group, ingroup, groupname, estimate);
+            }
+        }
+
+        hsize_t totalBytes = 0, totalChunks = 0;
+        std::stringstream json;
+        json << "{\n  \"groups\": [";
+        for (size_t i = 0; i < estimate.groups.size(); i++)
+        {
+            const GroupEstimate& group = estimate.groups[i];
+            json << ((i == 0)? "\n" : ",\n") << "    {\"name\": " << toJsonString(group.name)
+                 << ", \"selectedRows\": " << group.selectedRows << ", \"totalRows\": " << group.totalRows
+                 << ", \"segments\": " << group.segments << "}";
+        }
+        json << "\n  ],\n  \"datasets\": [";
+        for (size_t i = 0; i < estimate.datasets.size(); i++)
+        {
+            const DatasetEstimate& dataset = estimate.datasets[i];
+            json << ((i == 0)? "\n" : ",\n") << "    {\"name\": " << toJsonString(dataset.name)
+                 << ", \"rows\": " << dataset.rows << ", \"bytes\": " << dataset.bytes
+                 << ", \"chunks\": " << dataset.chunks << "}";
+            totalBytes += dataset.bytes;
+            totalChunks += dataset.chunks;
+        }
+        json << "\n  ],\n  \"totalBytes\": " << totalBytes << ",\n  \"totalChunks\": " << totalChunks << "\n}\n";
+
+        LOG_INFO("Subsetter::writeEstimate(): " << estimate.datasets.size() << " datasets, " << totalBytes
+                 << " bytes from " << totalChunks << " chunks");
+        if (outfilename.empty())
+        {
+            std::cout << json.str();
+            return 0;
+        }
+
+        std::ofstream jsonFile(outfilename.c_str());
+        jsonFile << json.str();
+        if (!jsonFile)
+        {
+            LOG_ERROR("Subsetter::writeEstimate(): ERROR: Unable to write the estimate to " << outfilename);
+            return 1;
+        }
+        LOG_INFO("Subsetter::writeEstimate(): WRITING estimate: " << outfilename);
+        return 0;
+    }
+
+    /**
+     * @brief Add the selections and projected output of a group to an
+     *        estimate, recursively.
+     *
+     *        This mirrors copyH5 and writeDataset: a dataset whose first
+     *        dimension matches the selection is projected to the selected
+     *        rows, any other dataset is written whole, and a dataset with an
+     *        empty selection is not written.
+     *
+     * @param in The input group.
+     * @param inRootGroup The input root group.
+     * @param groupname The name of the group.
+     * @param estimate The estimate to add to.
+     */
+    void estimateGroup(H5::Group& in, H5::Group& inRootGroup, const std::string& groupname, SubsetEstimate& estimate)
+    {
+        std::string metadataGroup = "/METADATA/";
+        bool isMetadataGroup = (boost::to_upper_copy<std::string>(groupname).compare(0, metadataGroup.length(), metadataGroup) == 0);
+        bool constrained = (geoboxes != NULL || temporal != NULL || geoPolygon != NULL);
+
+        IndexSelection* indexes = NULL;
+        if (!isMetadataGroup && constrained && config->isGroupSubsettable(shortName, groupname))
+        {
+            Coordinate* coor = getCoordinate(inRootGroup, in, groupname, subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+            indexes = (coor->indexesProcessed)? coor->indexes : coor->getIndexSelection();
+        }
+        if (indexes != NULL)
+        {
+            GroupEstimate group = {groupname, indexes->size(), indexes->getMaxSize(), indexes->getSegments().size()};
+            estimate.groups.push_back(group);
+        }
+
+        std::vector<H5Catalog::Entry> objects = listObjects(groupname);
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            std::string objname = objects[i].name;
+            std::string objectFullName = groupname + objname;
+
+            // Cache the objects in the same order as copyH5, which the
+            // granule version depends on.
+            config->addShortNameGroupDatasetFromGranuleFile(shortName, objectFullName + "/");
+
+            if (objects[i].type == "group" && subsetDataLayers->is_included(objectFullName + "/"))
+            {
+                H5::Group ingroup(in.openGroup(objname));
+                if (requiresTemporalSubsetting(inRootGroup, ingroup, objectFullName + "/"))
+                {
+                    groupsRequiringTemporalSubsetting.push_back(objectFullName + "/");
+                    continue;
+                }
+                estimateGroup(ingroup, inRootGroup, objectFullName + "/", estimate);
+            }
+            else if (objects[i].type == "dataset" && subsetDataLayers->is_dataset_included(objectFullName))
+            {
+                IndexSelection* datasetIndexes = indexes;
+                if (config->isPhotonDataset(shortName, objectFullName))
+                {
+                    Coordinate* coor = getCoordinate(inRootGroup, in, objectFullName, subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+                    datasetIndexes = coor->getIndexSelection();
+                }
+
+                const H5Catalog::Entry* dataset = catalog->getDataset(groupname, objname);
+                if (dataset == NULL) continue;
+
+                // Only the time range of a spatial subset bounds the deferred groups.
+                if (datasetIndexes != NULL && temporal == NULL && constrained)
+                {
+                    updateTimeRange(objname, in.openDataSet(objname), datasetIndexes);
+                }
+
+                // Project the output dimensions as writeDataset does.
+                std::vector<hsize_t> newdims(dataset->dims);
+                hsize_t points = 1;
+                for (size_t d = 0; d < dataset->dims.size(); d++)
+                {
+                    if (datasetIndexes != NULL && datasetIndexes->getMaxSize() == (long)dataset->dims[d])
+                    {
+                        newdims[d] = datasetIndexes->size();
+                    }
+                    points *= newdims[d];
+                }
+
+                DatasetEstimate datasetEstimate = {objectFullName, (newdims.empty())? 1 : newdims[0],
+                                                   points * dataset->typeSize,
+                                                   (points == 0)? 0 : countSelectedChunks(*dataset, newdims, datasetIndexes)};
+                estimate.datasets.push_back(datasetEstimate);
+            }
+        }
+    }
+
+    /**
+     * @brief Count the input chunks a subset of a chunked dataset reads.
+     *
+     * @param dataset The input dataset description.
+     * @param newdims The projected output dimensions.
+     * @param indexes The subset dataset indexes.
+     * @return The number of chunks, or 0 if the dataset is not chunked.
+     */
+    hsize_t countSelectedChunks(const H5Catalog::Entry& dataset, const std::vector<hsize_t>& newdims, IndexSelection* indexes)
+    {
+        if (dataset.layout != H5D_CHUNKED || dataset.chunkDims.size() != dataset.dims.size())
+        {
+            return 0;
+        }
+
+        hsize_t chunks = 1;
+        for (size_t d = 0; d < dataset.dims.size(); d++)
+        {
+            long chunk = dataset.chunkDims[d];
+            if (newdims[d] == dataset.dims[d])
+            {
+                chunks *= (dataset.dims[d] + chunk - 1) / chunk;
+                continue;
+            }
+
+            // The rows read, as (start, count) pairs, as in writeDataset.
+            std::map<long, long> rows = indexes->segments;
+            if (rows.empty())
+            {
+                rows[indexes->minIndexStart] = indexes->maxIndexEnd - indexes->minIndexStart;
+            }
+
+            // Segments are ordered, so a chunk shared by adjacent segments
+            // is only counted once.
+            hsize_t touched = 0;
+            long lastChunk = -1;
+            for (std::map<long, long>::iterator it = rows.begin(); it != rows.end(); it++)
+            {
+                long first = std::max(it->first / chunk, lastChunk + 1);
+                long last = (it->first + it->second - 1) / chunk;
+                if (last >= first)
+                {
+                    touched += last - first + 1;
+                    lastChunk = last;
+                }
+            }
+            chunks *= touched;
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief Quote a string as a JSON string.
+     */
+    static std::string toJsonString(const std::string& value)
+    {
+        std::string quoted = "\"";
+        for (std::string::const_iterator it = value.begin(); it != value.end(); it++)
+        {
+            if (*it == '"' || *it == '\\') quoted.push_back('\\');
+            quoted.push_back(*it);
+        }
+        return quoted + "\"";
+    }
+
+    /**
+     * @brief Determine if a group is deferred until the time range of the
+     *        spatially subset groups is known.
+     *
+     *        This is the case for a subsettable group, below only
+     *        subsettable groups, that has temporal but no spatial coordinates
+     *        in a request with only spatial constraints, the same groups
+     *        addGroupsRequiringTemporalSubsetting finds.
+     *
+     * @param rootGroup The input root group.
+     * @param group The input group.
+     * @param groupname The name of the group.
+     * @return true if the group requires temporal subsetting.
+     */
+    bool requiresTemporalSubsetting(H5::Group& rootGroup, H5::Group& group, const std::string& groupname)
+    {
+        if (temporal != NULL || (geoboxes == NULL && geoPolygon == NULL))
+        {
+            return false;
+        }
+
+        std::string metadataGroup = "/METADATA/";
+        if (boost::to_upper_copy<std::string>(groupname).compare(0, metadataGroup.length(), metadataGroup) == 0)
+        {
+            return false;
+        }
+
+        for (size_t slash = groupname.find('/', 1); slash != std::string::npos; slash = groupname.find('/', slash + 1))
+        {
+            if (!config->isGroupSubsettable(shortName, groupname.substr(0, slash + 1)))
+            {
+                return false;
+            }
+        }
+
+        Coordinate* coor = getCoordinate(rootGroup, group, groupname, subsetDataLayers, geoboxes, temporal, geoPolygon, config);
+        return coor->hasTemporalOnlyCoordinates();
+    }
+
     /**
      * @brief Subsets and writes groups recursively that need special
      *        temporal subsetting.
      *
      *        This occurs in the case where a group has no spatial coordinates
-     *        in requests that only spatial constraints.
+     *        in requests that only spatial constraints. copyH5 creates these
+     *        groups and their attributes, and defers their contents to here.
      *
      * @param rootGroup This root group.
      */
@@ -809,8 +1649,6 @@ private:
     {
         LOG_DEBUG("Subsetter::writeRequiredTemporalSubsets(): ENTER");
 
-        addGroupsRequiringTemporalSubsetting(rootGroup, rootGroup, "/");
-
         if (!groupsRequiringTemporalSubsetting.empty())
         {
             // Construct temporal constraints using calculated time range.
@@ -821,15 +1659,13 @@ private:
             // Write requested groups recursively.
             for (std::string groupname : this->groupsRequiringTemporalSubsetting)
             {
-                // Remove group from coordinate look-up map.
+                // Remove group from coordinate look-up map, its selection
+                // was found without the temporal constraints.
                 Coordinate::lookUpMap.erase(groupname);
 
-                // Remove and recreate output group.
                 H5::Group group = this->infile.openGroup(groupname);
-                H5::Group outGroupExisting = this->outfile.openGroup(groupname);
-                H5Ldelete(outGroupExisting.getLocId(), groupname.c_str(), H5P_DEFAULT);
-                H5::Group newOutGroup = this->outfile.createGroup(groupname);
-                copyH5(group, rootGroup, newOutGroup, groupname);
+                H5::Group outGroup = this->outfile.openGroup(groupname);
+                copyH5(group, rootGroup, outGroup, groupname);
             }
         }
     }
@@ -916,7 +1752,7 @@ private:
         message += p.filename().string();
         message += "\nExtracted the datasets named:\n";
         // A list of datasets to be included in the output file.
-        fullDatasetList->expand_all(infilename);
+        fullDatasetList->expand_all(getCatalog());
         std::vector < std::set <std::string> > datasets = fullDatasetList->getDatasets();
         std::vector < std::set <std::string> >::iterator it = datasets.begin();
         std::set <std::string>::iterator set_it;
@@ -1011,6 +1847,120 @@ private:
         return subsettable;
     }
 
+    /**
+     * @brief Check whether a dataset's selected rows can be copied as raw bytes.
+     *
+     *        This requires a contiguous input (not stored in external files)
+     *        in a file opened with the default (sec2) driver, a fixed-size datatype that contains no file
+     *        addresses or heap references, and a selection that only changes
+     *        the first (slowest varying) dimension.
+     *
+     * @param indataset The input dataset.
+     * @param dimnum The number of dimensions of the dataset.
+     * @param dim The dimension being subset.
+     * @param olddims The input dataset dimensions.
+     * @param newdims The output dataset dimensions.
+     * @return true if the dataset can be copied with copy_file_range.
+     */
+    bool isRawCopyable(const H5::DataSet& indataset, int dimnum, int dim, hsize_t* olddims, hsize_t* newdims)
+    {
+        H5::DSetCreatPropList plist = indataset.getCreatePlist();
+        if (dimnum == 0 || dim != 0 || plist.getLayout() != H5D_CONTIGUOUS || plist.getExternalCount() > 0)
+            return false;
+
+        for (int d = 1; d < dimnum; d++)
+        {
+            if (newdims[d] != olddims[d]) return false;
+        }
+
+        H5::DataType datatype(indataset.getDataType());
+        H5T_class_t typeClass = datatype.getClass();
+        if (typeClass == H5T_VLEN || typeClass == H5T_REFERENCE ||
+            H5Tdetect_class(datatype.getId(), H5T_VLEN) > 0 || H5Tdetect_class(datatype.getId(), H5T_REFERENCE) > 0 ||
+            (typeClass == H5T_STRING && H5Tis_variable_str(datatype.getId()) > 0))
+            return false;
+
+        return getSec2FileDescriptor(infile) >= 0 && getSec2FileDescriptor(outfile) >= 0;
+    }
+
+    /**
+     * @brief Return the file descriptor of a file opened with the sec2 driver.
+     *
+     * @param file The HDF5 file.
+     * @return The file descriptor, or -1 if the file uses another driver.
+     */
+    int getSec2FileDescriptor(const H5::H5File& file)
+    {
+        H5::FileAccPropList fapl = file.getAccessPlist();
+        if (fapl.getDriver() != H5FD_SEC2)
+            return -1;
+
+        int* handle = NULL;
+        if (H5Fget_vfd_handle(file.getId(), fapl.getId(), (void**)&handle) < 0 || handle == NULL)
+            return -1;
+        return *handle;
+    }
+
+    /**
+     * @brief Copy the selected rows of a contiguous dataset with copy_file_range.
+     *
+     * @param indataset The input dataset.
+     * @param outdataset The early-allocated contiguous output dataset.
+     * @param indexes The subset dataset indexes.
+     * @param dimnum The number of dimensions of the dataset.
+     * @param olddims The input dataset dimensions.
+     * @param newdims The output dataset dimensions.
+     * @return true if all rows were copied, false if the caller must fall back
+     *         to a buffered copy.
+     */
+    bool copyContiguousSegments(const H5::DataSet& indataset, H5::DataSet& outdataset, IndexSelection* indexes,
+                                int dimnum, hsize_t* olddims, hsize_t* newdims)
+    {
+        haddr_t inAddress = H5Dget_offset(indataset.getId());
+        haddr_t outAddress = H5Dget_offset(outdataset.getId());
+        if (inAddress == HADDR_UNDEF || outAddress == HADDR_UNDEF)
+        {
+            LOG_DEBUG("Subsetter::copyContiguousSegments(): storage not allocated, using buffered copy");
+            return false;
+        }
+
+        // Size in bytes of one row along the subset dimension.
+        size_t rowSize = indataset.getDataType().getSize();
+        for (int d = 1; d < dimnum; d++)
+            rowSize *= olddims[d];
+
+        // The rows to copy, as (start, count) pairs.
+        std::map<long, long> rows;
+        if (newdims[0] == olddims[0])
+            rows[0] = olddims[0];
+        else if (indexes->segments.empty())
+            rows[indexes->minIndexStart] = indexes->maxIndexEnd - indexes->minIndexStart;
+        else
+            rows = indexes->segments;
+
+        int infd = getSec2FileDescriptor(infile);
+        int outfd = getSec2FileDescriptor(outfile);
+        loff_t outOffset = outAddress;
+        for (std::map<long, long>::iterator it = rows.begin(); it != rows.end(); it++)
+        {
+            loff_t inOffset = inAddress + it->first * rowSize;
+            size_t remaining = it->second * rowSize;
+            while (remaining > 0)
+            {
+                ssize_t copied = copy_file_range(infd, &inOffset, outfd, &outOffset, remaining, 0);
+                if (copied <= 0)
+                {
+                    LOG_DEBUG("Subsetter::copyContiguousSegments(): copy_file_range failed (" << strerror(errno)
+                              << "), using buffered copy");
+                    return false;
+                }
+                remaining -= copied;
+            }
+        }
+
+        return true;
+    }
+
     /* private members */
 
     // subset data layers
@@ -1040,6 +1990,25 @@ private:
     // set to true when matching data is found
     bool matchingDataFound;
 
+    // copy contiguous datasets with copy_file_range
+    bool copyFileRange = false;
+
+    // only estimate the subset, see setEstimate
+    bool estimateOnly = false;
+
+    // largest input size, in bytes, whose output is built in memory
+    hsize_t inMemoryOutputCap = 0;
+
+    // catalog of the input hierarchy, deleted with the subsetter when owned
+    H5Catalog* catalog = NULL;
+    bool ownsCatalog = false;
+
+    // allocation increment for the in-memory output image
+    static constexpr size_t CORE_DRIVER_INCREMENT = 8 * 1024 * 1024;
+
+    // degrees by which granule extents are widened, as they may be rounded
+    static constexpr double EXTENT_TOLERANCE = 0.001;
+
     // subset time range <minimum, maximum>
     std::pair<double, double> timeRange;
 
@@ -156,7 +156,7 @@ public:
         if (temporal != NULL && timeSet != NULL)
         {
             updateEpochTime(timeSet);
-            timeSet->read(time, timeSet->getDataType());
+            readCoordinateValues(timeSet, time);
             temporalSubset(time);
         }
         else LOG_DEBUG("SuperGroupCoordinate::getIndexSelection(): "
@@ -166,22 +166,18 @@ public:
         // read lat/lon datasets if spatial(bbox/polygon) constraints exist
         if ((geoboxes != NULL || geoPolygon != NULL) && this->coorDatasets.size() != 0)
         {
-            for (int i = 0; i < this->latitudes.size(); i++)
-            {
-                double* lat = new double[coordinateSize];
-                double* lon = new double[coordinateSize];
-                readLatLonDatasets(this->coorDatasets.find(this->latitudes[i])->second, this->coorDatasets.find(this->longitudes[i])->second, lat,lon);
-                this->coors.insert(std::pair<std::string, double*>(this->latitudes[i],lat));
-                this->coors.insert(std::pair<std::string, double*>(this->longitudes[i],lon));
-            }
-        }
+            readPairValues();
 
-        // limit the index by spatial constraint
-        if (geoboxes != NULL && this->coorDatasets.size() != 0) spatialBboxSubset();
-        else LOG_DEBUG("SuperGroupCoordinate::getIndexSelection(): spatial constraint or lat/lon coordinates not found");
-        // limit the index by polygon
-        if (geoPolygon != NULL && this->coorDatasets.size() != 0) spatialPolygonSubset();
-        else LOG_DEBUG("SuperGroupCoordinate::getIndexSelection(): polygon or lat/lon coordinates not found");
+            // every point within the temporal constraint is checked, a point is
+            // selected when any of its lat/lon pairs is within the constraint
+            std::vector<unsigned char> mask(std::max(indexes->maxIndexEnd - indexes->minIndexStart, 0L), VALID_POINT);
+
+            // limit the index by polygon, which replaces the bbox selection,
+            // or else by spatial constraint
+            if (geoPolygon != NULL) spatialPolygonSubset(mask);
+            else spatialBboxSubset(mask);
+        }
+        else LOG_DEBUG("SuperGroupCoordinate::getIndexSelection(): spatial constraint, polygon or lat/lon coordinates not found");
 
         indexesProcessed = true;
 
@@ -193,124 +189,84 @@ private:
     std::vector<std::string> latitudes;
     std::vector<std::string> longitudes;
     std::map<std::string, H5::DataSet*> coorDatasets;
-    std::map<std::string, double*> coors;
+
+    // the latitudes and longitudes of every lat/lon pair, one array after
+    // another in a single block, and the start of each pair's arrays
+    std::vector<double> pairValues;
+    std::vector<const double*> pairLatitudes;
+    std::vector<const double*> pairLongitudes;
+
+    void readPairValues()
+    {
+        size_t pairCount = latitudes.size();
+        pairValues.resize(2 * pairCount * coordinateSize);
+        pairLatitudes.clear();
+        pairLongitudes.clear();
+        for (size_t j = 0; j < pairCount; j++)
+        {
+            double* lat = pairValues.data() + 2 * j * coordinateSize;
+            double* lon = lat + coordinateSize;
+            readLatLonDatasets(this->coorDatasets.find(latitudes[j])->second, this->coorDatasets.find(longitudes[j])->second, lat, lon);
+            pairLatitudes.push_back(lat);
+            pairLongitudes.push_back(lon);
+        }
+    }
 
     // limit the index range by spatial constraints
-    void spatialBboxSubset()
+    void spatialBboxSubset(std::vector<unsigned char>& mask)
     {
         LOG_DEBUG("SuperGroupCoordinate::spatialBboxSubset(): ENTER");
 
-        bool contains = false;
-
-        long indexBegin = indexes->minIndexStart, indexEnd = indexes->maxIndexEnd - 1;
-        long start = 0, length = 0;
-        for (int i=indexBegin; i<=indexEnd; i++)
+        for (std::vector<geobox>::iterator it = geoboxes->begin(); it != geoboxes->end(); it++)
         {
-            std::vector<geobox>::iterator geobox_it = geoboxes->begin();
-            for (; geobox_it != geoboxes->end(); geobox_it++)
-            {
-                for (int j = 0; j < latitudes.size(); j++)
-                {
-                    if (geobox_it->contains(coors[latitudes[j]][i], coors[longitudes[j]][i]))
-                    {
-                        contains = true;
-                        break;
-                    }
-                    else contains = false;
-                }
-                if (contains)
-                {
-                    if (length == 0) start = i;
-                    length++;
-                    break;
-                }
-            }
-            // not covered by the bbox
-            if (geobox_it == geoboxes->end())
-            {
-                if (length != 0)
-                {
-                    indexes->addSegment(start, length);
-                    length = 0;
-                }
-            }
-
+            for (size_t j = 0; j < pairLatitudes.size(); j++) markBboxPoints(*it, j, IN_BBOX, mask);
         }
+        addMaskSegments(mask, IN_BBOX);
+    }
 
-        // if new index range found, but does not have an end point, add it
-        if (length != 0) indexes->addSegment(start, length);
-        // if no index range found, return no data
-        if (indexes->segments.empty()) indexes->addRestriction(0, 0);
+    // set a bit of the mask for the points of which a lat/lon pair is within
+    // the bounding box
+    void markBboxPoints(geobox& box, size_t pair, unsigned char bit, std::vector<unsigned char>& mask)
+    {
+        const double* lat = pairLatitudes[pair] + indexes->minIndexStart;
+        const double* lon = pairLongitudes[pair] + indexes->minIndexStart;
+        for (size_t k = 0; k < mask.size(); k++)
+        {
+            if (box.contains(lat[k], lon[k])) mask[k] |= bit;
+        }
     }
 
     // limit the index range by polygon
-    void spatialPolygonSubset()
+    // the exact polygon test is only made for the lat/lon pairs within the
+    // bounding box of the polygon, of points not already within it
+    void spatialPolygonSubset(std::vector<unsigned char>& mask)
     {
         LOG_DEBUG("SuperGroupCoordinate::spatialPolygonSubset(): ENTER");
 
-        IndexSelection* newIndexes = new IndexSelection(coordinateSize);
-
-        geobox g = geoPolygon->getBbox();
-        if (geoboxes == NULL) geoboxes = new std::vector<geobox>();
-        geoboxes->push_back(g);
-
-        LOG_DEBUG("SuperGroupCoordinate::spatialPolygonSubset(): geoboxes.size(): " << geoboxes->size());
-
-        spatialBboxSubset();
-        LOG_DEBUG("SuperGroupCoordinate::spatialPolygonSubset(): indexes->size(): " << indexes->size());
-
-        if (indexes->size() == 0) return;
+        long indexBegin = indexes->minIndexStart;
+        geobox envelope = geoPolygon->getBbox();
+        PolygonTrack track(geoPolygon);
 
-        long start = 0, length = 0;
-        bool contains = false;
-
-        for (std::map<long, long>::iterator it = indexes->segments.begin(); it != indexes->segments.end(); it++)
+        for (size_t j = 0; j < pairLatitudes.size(); j++)
         {
-            for (int i = it->first; i != it->second+it->first; i++)
-            {
-                // count in the points with fill values
-                for (int j = 0; j < latitudes.size(); j++)
-                {
-                    if (geoPolygon->contains(coors[latitudes[j]][i], coors[longitudes[j]][i]))
-                    {
-                        contains = true;
-                        break;
-                    }
-                    else contains = false;
-                }
-                if (contains)
-                {
-                    if(length == 0) start = i;
-                    length++;
-                }
-                else
-                {
-                    if (length != 0)
-                    {
-                        newIndexes->addSegment(start, length);
-                        length = 0;
-                    }
-                }
-            }
-            if (length != 0)
+            for (size_t k = 0; k < mask.size(); k++) mask[k] &= ~IN_ENVELOPE;
+            markBboxPoints(envelope, j, IN_ENVELOPE, mask);
+
+            // follow the pair through each run of consecutive points to check
+            size_t previous = 0;
+            bool tracking = false;
+            for (size_t k = 0; k < mask.size(); k++)
             {
-                newIndexes->addSegment(start, length);
-                length = 0;
-            }
+                if ((mask[k] & (IN_ENVELOPE | IN_POLYGON)) != IN_ENVELOPE) continue;
+                if (!tracking || k != previous + 1) track.reset();
+                previous = k;
+                tracking = true;
 
+                if (track.contains(pairLatitudes[j][indexBegin + k], pairLongitudes[j][indexBegin + k])) mask[k] |= IN_POLYGON;
+            }
         }
 
-        // if new index range found, but does not have an end point, add it
-        if (length != 0) newIndexes->addSegment(start, length);
-        // if no index range found, return no data
-        if (newIndexes->segments.empty()) newIndexes->addRestriction(0, 0);
-
-        indexes = newIndexes;
-
-        // if new index range found, but does not have an end point, add it
-        if (length != 0) indexes->addSegment(start, length);
-        // if no index range found, return no data
-        if (indexes->segments.empty()) indexes->addRestriction(0, 0);
+        addMaskSegments(mask, IN_POLYGON);
     }
 };
 #endif
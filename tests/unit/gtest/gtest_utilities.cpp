@@ -46,3 +46,64 @@ int64_t* gtest_utilities::readDataset(std::string input_file, std::string datase
 
     return dataset_array;
 }
+
+
+/**
+ * @brief This function creates an HDF5 file held in memory (core driver,
+ *        without a backing store), for tests building their own input.
+ *
+ * @param file_name The name of the file, which is never written to disk.
+ * @return The opened file.
+ */
+H5::H5File gtest_utilities::createInMemoryFile(std::string file_name)
+{
+    H5::FileAccPropList fapl;
+    fapl.setCore(1024 * 1024, false);
+    return H5::H5File(file_name, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, fapl);
+}
+
+
+/**
+ * @brief This function writes a one dimensional integer dataset.
+ *
+ * @param group The group the dataset is created in.
+ * @param dataset_name The dataset name.
+ * @param values The dataset values.
+ * @param file_type The dataset datatype in the file.
+ * @return The dataset.
+ */
+H5::DataSet gtest_utilities::writeDataset(H5::Group& group, std::string dataset_name,
+                                          const std::vector<int64_t>& values,
+                                          const H5::PredType& file_type)
+{
+    hsize_t dims[1] = {values.size()};
+    H5::DataSpace space(1, dims);
+    H5::DataSet dataset = group.createDataSet(dataset_name, file_type, space);
+    if (!values.empty())
+    {
+        dataset.write(values.data(), H5::PredType::NATIVE_INT64);
+    }
+    return dataset;
+}
+
+
+/**
+ * @brief This function writes a one dimensional double dataset.
+ *
+ * @param group The group the dataset is created in.
+ * @param dataset_name The dataset name.
+ * @param values The dataset values.
+ * @return The dataset.
+ */
+H5::DataSet gtest_utilities::writeDataset(H5::Group& group, std::string dataset_name,
+                                          const std::vector<double>& values)
+{
+    hsize_t dims[1] = {values.size()};
+    H5::DataSpace space(1, dims);
+    H5::DataSet dataset = group.createDataSet(dataset_name, H5::PredType::NATIVE_DOUBLE, space);
+    if (!values.empty())
+    {
+        dataset.write(values.data(), H5::PredType::NATIVE_DOUBLE);
+    }
+    return dataset;
+}
@@ -2,11 +2,20 @@
 #define Gtest_utilities
 
 #include <string>
+#include <vector>
+
+#include "H5Cpp.h"
 
 namespace gtest_utilities
 {
     std::string getFullPath(std::string relative_path);
     int64_t* readDataset(std::string input_file, std::string dataset_name);
+    H5::H5File createInMemoryFile(std::string file_name);
+    H5::DataSet writeDataset(H5::Group& group, std::string dataset_name,
+                             const std::vector<int64_t>& values,
+                             const H5::PredType& file_type = H5::PredType::NATIVE_INT64);
+    H5::DataSet writeDataset(H5::Group& group, std::string dataset_name,
+                             const std::vector<double>& values);
 
 }
 
@@ -529,4 +529,33 @@ namespace
         EXPECT_EQ(expectedVersion, version);
     }
 
+    // The resolved group names follow the freeboard swath segment flag
+    TEST_F(test_ATL10_v006_Configuration, ATL10_getReferencedGroupname_isLeadsGroup_setFreeboardSwathSegment)
+    {
+        std::string group = "/gt1l/leads/";
+        std::string groupname = configuration_a->getReferencedGroupname(shortName, group);
+        EXPECT_EQ("/gt1l/reference_surface_section/", groupname);
+
+        configuration_a->setFreeboardSwathSegment(true);
+        groupname = configuration_a->getReferencedGroupname(shortName, group);
+        EXPECT_EQ("/freeboard_swath_segment/", groupname);
+
+        configuration_a->setFreeboardSwathSegment(false);
+        groupname = configuration_a->getReferencedGroupname(shortName, group);
+        EXPECT_EQ("/gt1l/reference_surface_section/", groupname);
+    }
+
+    // The resolved group names follow the granule version once it is known
+    TEST_F(test_ATL10_v006_Configuration, ATL10_getReferencedGroupname_isLeadsGroup_version_added)
+    {
+        std::string group = "/gt1l/leads/";
+        std::string groupname = configuration_c->getReferencedGroupname(shortName, group);
+        EXPECT_EQ("", groupname);
+
+        configuration_c->addShortNameGroupDatasetFromGranuleFile(shortName, "/gt1l/");
+        configuration_c->addShortNameGroupDatasetFromGranuleFile(shortName, "/gt1l/freeboard_segment/");
+        groupname = configuration_c->getReferencedGroupname(shortName, group);
+        EXPECT_EQ("/gt1l/reference_surface_section/", groupname);
+    }
+
 }  // namespace
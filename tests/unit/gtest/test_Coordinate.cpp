@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "gtest_utilities.h"
+
+#include "H5Cpp.h"
+#include "../../../subsetter/Coordinate.h"
+#include "../../../subsetter/ReverseReferenceCoordinates.h"
+#include "../../../subsetter/Configuration.h"
+#include "../../../subsetter/geobox.h"
+#include "../../../subsetter/GeoPolygon.h"
+#include "../../../subsetter/SubsetDataLayers.h"
+
+
+class CoordinateTest : public ::testing::Test
+{
+protected:
+    CoordinateTest()
+    {
+        std::string config_file_path = gtest_utilities::getFullPath("harmony_service/subsetter_config.json");
+        config = std::make_unique<Configuration>(config_file_path);
+        subsetDataLayers = std::make_unique<SubsetDataLayers>(variables);
+
+        inputFile = H5::H5File(gtest_utilities::getFullPath("tests/data/ATL03_gt1l.h5"), H5F_ACC_RDONLY);
+        lat = readValues(inputFile, "/gt1l/heights/lat_ph");
+        lon = readValues(inputFile, "/gt1l/heights/lon_ph");
+
+        Coordinate::resetLookUp();
+    }
+
+    ~CoordinateTest()
+    {
+        Coordinate::resetLookUp();
+    }
+
+    static std::vector<double> readValues(H5::H5File& file, const std::string& datasetName)
+    {
+        H5::DataSet dataset = file.openDataSet(datasetName);
+        std::vector<double> values(dataset.getSpace().getSimpleExtentNpoints());
+        dataset.read(values.data(), H5::PredType::NATIVE_DOUBLE);
+        return values;
+    }
+
+    /*
+     * @brief Read a polygon from GeoJSON text.
+     */
+    void setPolygon(const std::string& geojson)
+    {
+        geopolygon = std::make_unique<GeoPolygon>(geojson);
+        geopolygon->getBbox();
+    }
+
+    /*
+     * @brief Write the photon coordinates of the test granule to a file held
+     *        in memory, with the given points replaced by fill values.
+     */
+    H5::H5File writeTrack(const std::vector<long>& fillPoints)
+    {
+        std::vector<double> latitudes = lat, longitudes = lon;
+        for (std::vector<long>::const_iterator it = fillPoints.begin(); it != fillPoints.end(); it++)
+        {
+            latitudes[*it] = FILL_VALUE;
+            longitudes[*it] = FILL_VALUE;
+        }
+
+        // The Coordinate instances are not freed, and keep the files of
+        // earlier tests open, so each test names its file.
+        H5::H5File file = gtest_utilities::createInMemoryFile(
+            std::string("coordinate_test_") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".h5");
+        H5::Group group = file.createGroup("/gt1l");
+        group = file.createGroup("/gt1l/heights");
+        gtest_utilities::writeDataset(group, "lat_ph", latitudes);
+        gtest_utilities::writeDataset(group, "lon_ph", longitudes);
+        return file;
+    }
+
+    /*
+     * @brief Select the photons of a file within the spatial constraints,
+     *        and return the selected (start, length) index ranges.
+     *
+     *        The groups are listed both by walking them and from a catalog
+     *        of the file, which select the same photons.
+     */
+    std::map<long, long> select(H5::H5File& file)
+    {
+        Coordinate::resetLookUp();
+        std::map<long, long> segments = selectSegments(file);
+
+        H5Catalog catalog(file);
+        Coordinate::CatalogScope catalogScope(&catalog);
+        Coordinate::resetLookUp();
+        EXPECT_EQ(selectSegments(file), segments);
+        return segments;
+    }
+
+    std::map<long, long> selectSegments(H5::H5File& file)
+    {
+        H5::Group root = file.openGroup("/");
+        H5::Group ingroup = file.openGroup("/gt1l/heights");
+        Coordinate* coordinate = Coordinate::getCoordinate(root, ingroup, "/gt1l/heights/", "ATL03", subsetDataLayers.get(),
+                                                           geoboxes.get(), nullptr, geopolygon.get(), config.get());
+        IndexSelection* indexes = coordinate->getIndexSelection();
+        EXPECT_NE(indexes, nullptr);
+        return (indexes == nullptr)? std::map<long, long>() : indexes->segments;
+    }
+
+    /*
+     * @brief Select the photons within the spatial constraints point by point,
+     *        where fill values extend an index range, and a valid point outside
+     *        the constraints ends it.
+     */
+    std::map<long, long> scan(const std::vector<long>& fillPoints)
+    {
+        std::map<long, long> segments;
+        long start = 0, length = 0;
+        for (long i = 0; i < (long)lat.size(); i++)
+        {
+            bool fill = std::find(fillPoints.begin(), fillPoints.end(), i) != fillPoints.end();
+            bool inside = geopolygon ? geopolygon->contains(lat[i], lon[i]) : inBoxes(lat[i], lon[i]);
+            if (fill)
+            {
+                if (length != 0) length++;
+            }
+            else if (inside)
+            {
+                if (length == 0) start = i;
+                length++;
+            }
+            else if (length != 0)
+            {
+                segments[start] = length;
+                length = 0;
+            }
+        }
+        if (length != 0) segments[start] = length;
+        return segments;
+    }
+
+    bool inBoxes(double latitude, double longitude)
+    {
+        for (std::vector<geobox>::iterator it = geoboxes->begin(); it != geoboxes->end(); it++)
+        {
+            if (it->contains(latitude, longitude)) return true;
+        }
+        return false;
+    }
+
+    static constexpr double FILL_VALUE = 3.4028234663852886e+38;
+
+    H5::H5File inputFile;
+    std::vector<double> lat, lon;
+
+    std::unique_ptr<Configuration> config;
+    std::unique_ptr<SubsetDataLayers> subsetDataLayers;
+    std::unique_ptr<std::vector<geobox>> geoboxes;
+    std::unique_ptr<GeoPolygon> geopolygon;
+    std::vector<std::string> variables;
+};
+
+
+// A latitude band around the turning latitude of the track selects the points
+// before and after it.
+TEST_F(CoordinateTest, getIndexSelection_bbox_only)
+{
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-180, 87.2981, 180, 87.2984));
+
+    std::map<long, long> expected = {{23, 193}, {449, 188}};
+    EXPECT_EQ(select(inputFile), expected);
+    EXPECT_EQ(select(inputFile), scan({}));
+}
+
+
+TEST_F(CoordinateTest, getIndexSelection_polygon_only)
+{
+    setPolygon("{\"type\": \"Polygon\", \"coordinates\": "
+               "[[[95.08, 87.2940], [95.16, 87.2940], [95.16, 87.2990], [95.08, 87.2940]]]}");
+
+    std::map<long, long> expected = {{588, 980}};
+    EXPECT_EQ(select(inputFile), expected);
+    EXPECT_EQ(select(inputFile), scan({}));
+}
+
+
+// The polygon replaces the bounding box selection.
+TEST_F(CoordinateTest, getIndexSelection_bbox_and_polygon)
+{
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-180, 87.2981, 180, 87.2984));
+    setPolygon("{\"type\": \"Polygon\", \"coordinates\": "
+               "[[[95.08, 87.2940], [95.16, 87.2940], [95.16, 87.2990], [95.08, 87.2940]]]}");
+
+    std::map<long, long> expected = {{588, 980}};
+    EXPECT_EQ(select(inputFile), expected);
+}
+
+
+// Fill values within a selected run, and following it, extend the run, and
+// fill values outside any run do not start one. The last run ends with the
+// fill values at the end of the track.
+TEST_F(CoordinateTest, getIndexSelection_bbox_fill_values)
+{
+    geoboxes = std::make_unique<std::vector<geobox>>();
+    geoboxes->push_back(geobox(-180, 87.2981, 180, 87.2984));
+    geoboxes->push_back(geobox(-180, 87.2940, 180, 87.2946));
+    std::vector<long> fillPoints = {100, 216, 217, 300, 2800, 2907, 2908};
+    H5::H5File file = writeTrack(fillPoints);
+
+    std::map<long, long> expected = {{23, 195}, {449, 188}, {2749, 160}};
+    EXPECT_EQ(select(file), expected);
+    EXPECT_EQ(select(file), scan(fillPoints));
+}
+
+
+// Fill values within and at the end of the polygon selection.
+TEST_F(CoordinateTest, getIndexSelection_polygon_fill_values)
+{
+    setPolygon("{\"type\": \"Polygon\", \"coordinates\": "
+               "[[[95.08, 87.2940], [95.16, 87.2940], [95.16, 87.2990], [95.08, 87.2940]]]}");
+    std::vector<long> fillPoints = {587, 600, 601, 1568, 1569};
+    H5::H5File file = writeTrack(fillPoints);
+
+    std::map<long, long> expected = {{588, 982}};
+    EXPECT_EQ(select(file), expected);
+    EXPECT_EQ(select(file), scan(fillPoints));
+}
+
+
+// The points of a trajectory turning twice are split into runs of monotonic
+// latitude, including latitudes repeated at a turn, and fill values and a
+// latitude that is not a number end a run. The latitude band of each
+// bounding box is searched in every run, and a bounding box wrapping across
+// the latitude range is checked in full.
+TEST_F(CoordinateTest, getIndexSelection_bbox_turning_latitudes)
+{
+    lat.clear();
+    lon.clear();
+    for (int i = 0; i <= 200; i++) lat.push_back(10 + i * 0.05);
+    lat.push_back(lat.back());
+    for (int i = 1; i <= 140; i++) lat.push_back(20 - i * 0.05);
+    for (int i = 1; i <= 240; i++) lat.push_back(13 + i * 0.05);
+    for (size_t i = 0; i < lat.size(); i++) lon.push_back(-10 + 20.0 * i / lat.size());
+    lat[300] = std::numeric_limits<double>::quiet_NaN();
+    std::vector<long> fillPoints = {0, 150, 151, 250, 400, (long)lat.size() - 1};
+    H5::H5File file = writeTrack(fillPoints);
+
+    geoboxes = std::make_unique<std::vector<geobox>>();
+    geoboxes->push_back(geobox(-180, 14, 180, 16));
+    geoboxes->push_back(geobox(-5, 18, 5, 22));
+
+    std::map<long, long> expected = {{80, 41}, {160, 82}, {281, 19}, {301, 21}, {361, 41}};
+    EXPECT_EQ(select(file), expected);
+    EXPECT_EQ(select(file), scan(fillPoints));
+
+    geoboxes->push_back(geobox(-180, 24.5, 180, 11));
+
+    expected = {{1, 20}, {80, 41}, {160, 82}, {281, 19}, {301, 21}, {361, 41}, {571, 11}};
+    EXPECT_EQ(select(file), expected);
+    EXPECT_EQ(select(file), scan(fillPoints));
+}
+
+
+/*
+ * @brief Select the rows of an index begin dataset referencing the given
+ *        (start, length) pairs of a referenced group of 10 rows.
+ */
+static std::map<long, long> selectReferencingRows(const std::vector<int32_t>& indexBegin,
+                                                  const std::vector<std::pair<long, long>>& referencedSegments)
+{
+    IndexSelection referencedIndexes(10);
+    for (std::vector<std::pair<long, long>>::const_iterator it = referencedSegments.begin();
+         it != referencedSegments.end(); it++)
+    {
+        referencedIndexes.addSegment(it->first, it->second);
+    }
+
+    IndexSelection indexes(indexBegin.size());
+    ReverseReferenceCoordinates::selectReferencingRows(indexBegin, referencedIndexes, indexes);
+    return indexes.segments;
+}
+
+
+// The rows of fragmented referenced segments are found by sweeping the
+// sorted index begin values.
+TEST(ReverseReferenceCoordinatesTest, selectReferencingRows_sorted)
+{
+    std::vector<int32_t> indexBegin = {1, 1, 2, 3, 3, 3, 5, 6, 6, 8};
+
+    std::map<long, long> expected = {{0, 2}, {3, 6}};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{0, 1}, {2, 1}, {4, 3}}), expected);
+
+    expected = {{2, 1}, {9, 1}};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{1, 1}, {7, 1}}), expected);
+
+    expected = {};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{3, 1}, {8, 2}}), expected);
+}
+
+
+// Fill values in the middle of the index begin values do not take the
+// fallback for out of order values. The fill values within the rows of a
+// referenced segment are selected with them, and the ones following them
+// are not.
+TEST(ReverseReferenceCoordinatesTest, selectReferencingRows_fill_values)
+{
+    std::vector<int32_t> indexBegin = {1, 1, 0, 2, 3, 0, 3, 3, 0, 5, 6, 6, 0, 8, -1};
+
+    std::map<long, long> expected = {{0, 2}, {4, 4}, {9, 3}};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{0, 1}, {2, 1}, {4, 3}}), expected);
+
+    expected = {{13, 1}};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{7, 1}}), expected);
+}
+
+
+// The rows of out of order index begin values are found from both ends for
+// each referenced segment.
+TEST(ReverseReferenceCoordinatesTest, selectReferencingRows_out_of_order)
+{
+    std::vector<int32_t> indexBegin = {1, 2, 3, 2, 4, 5};
+
+    std::map<long, long> expected = {{1, 3}, {5, 1}};
+    EXPECT_EQ(selectReferencingRows(indexBegin, {{1, 1}, {4, 1}}), expected);
+}
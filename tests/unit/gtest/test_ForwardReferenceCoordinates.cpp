@@ -26,6 +26,7 @@ protected:
         // Read in test data.
         // This index begin dataset starts and ends with fill values (0).
         index_begin_dataset = gtest_utilities::readDataset(gtest_utilities::getFullPath("tests/data/ATL03_indexbegin_start_end_FVs.h5"), "ph_index_beg");
+        non_fill_tables = std::make_unique<ForwardReferenceCoordinates::NonFillTables>(index_begin_dataset, INDEX_BEGIN_SIZE);
 
     }
 
@@ -34,7 +35,10 @@ protected:
         delete index_begin_dataset;
     }
 
+    static constexpr long INDEX_BEGIN_SIZE = 149697;
+
     int64_t* index_begin_dataset = nullptr;
+    std::unique_ptr<ForwardReferenceCoordinates::NonFillTables> non_fill_tables;
     std::unique_ptr<ForwardReferenceCoordinates> coordinate_object;
 
 private:
@@ -68,6 +72,17 @@ TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_nonFV_end_nonFV)
 
     EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
     EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
+
+    // The same segment is found through the non-fill tables.
+    firstTrajIndex_result = 0;
+    trajSegLength_result = 0;
+    coordinate_object->defineOneSegment(selectedStartIdx, selectedCount,
+                                        firstTrajIndex_result, trajSegLength_result,
+                                        maxIndexBegIdx, maxTrajIndex,
+                                        this->index_begin_dataset, this->non_fill_tables.get());
+
+    EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
+    EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
 }
 
 TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_FV_end_FV)
@@ -90,6 +105,17 @@ TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_FV_end_FV)
 
     EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
     EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
+
+    // The same segment is found through the non-fill tables.
+    firstTrajIndex_result = 0;
+    trajSegLength_result = 0;
+    coordinate_object->defineOneSegment(selectedStartIdx, selectedCount,
+                                        firstTrajIndex_result, trajSegLength_result,
+                                        maxIndexBegIdx, maxTrajIndex,
+                                        this->index_begin_dataset, this->non_fill_tables.get());
+
+    EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
+    EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
 }
 
 TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_nonFV_end_FVall)
@@ -113,6 +139,17 @@ TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_nonFV_end_FVall)
     EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
     EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
 
+    // The same segment is found through the non-fill tables.
+    firstTrajIndex_result = 0;
+    trajSegLength_result = 0;
+    coordinate_object->defineOneSegment(selectedStartIdx, selectedCount,
+                                        firstTrajIndex_result, trajSegLength_result,
+                                        maxIndexBegIdx, maxTrajIndex,
+                                        this->index_begin_dataset, this->non_fill_tables.get());
+
+    EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
+    EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
+
 }
 
 TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_FVall_end_nonFV)
@@ -135,4 +172,15 @@ TEST_F(ForwardReferenceCoordinatesTest, DefineOneSegment_start_FVall_end_nonFV)
 
     EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
     EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
+
+    // The same segment is found through the non-fill tables.
+    firstTrajIndex_result = 0;
+    trajSegLength_result = 0;
+    coordinate_object->defineOneSegment(selectedStartIdx, selectedCount,
+                                        firstTrajIndex_result, trajSegLength_result,
+                                        maxIndexBegIdx, maxTrajIndex,
+                                        this->index_begin_dataset, this->non_fill_tables.get());
+
+    EXPECT_EQ(firstTrajIndex_expected, firstTrajIndex_result);
+    EXPECT_EQ(trajSegLength_expected, trajSegLength_result);
 }
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "gtest_utilities.h"
+
+#include "H5Cpp.h"
+#include "../../../subsetter/Configuration.h"
+#include "../../../subsetter/IndexSelection.h"
+#include "../../../subsetter/SubsetDataLayers.h"
+#include "../../../subsetter/FwdRefBeginDataset.h"
+
+
+class FwdRefBeginDatasetTest : public ::testing::Test
+{
+protected:
+    FwdRefBeginDatasetTest()
+    {
+        std::string config_file_path = gtest_utilities::getFullPath("harmony_service/subsetter_config.json");
+        config = std::make_unique<Configuration>(config_file_path);
+
+        file = gtest_utilities::createInMemoryFile("fwd_ref_begin_test.h5");
+        ingroup = file.createGroup("/BEAM0000");
+        outgroup = file.createGroup("/out");
+    }
+
+    /*
+     * @brief Write the GEDI rx_sample_start_index dataset for a selection of
+     *        its rows, and return the values written.
+     *
+     * @param beginIn The input begin values.
+     * @param segments The selected rows, as (start, count) pairs.
+     */
+    std::vector<int64_t> writeBegin(const std::vector<int64_t>& beginIn,
+                                    const std::vector<std::pair<long, long>>& segments)
+    {
+        H5::DataSet indataset = gtest_utilities::writeDataset(ingroup, "rx_sample_start_index", beginIn,
+                                                              H5::PredType::STD_U64LE);
+
+        IndexSelection selection(beginIn.size());
+        long selectedSize = 0;
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            selection.addSegment(segments[i].first, segments[i].second);
+            selectedSize += segments[i].second;
+        }
+
+        // The subset count dataset is written before the begin dataset.
+        gtest_utilities::writeDataset(outgroup, "rx_sample_count", std::vector<int64_t>(selectedSize, 1));
+
+        SubsetDataLayers subsetDataLayers(std::vector<std::string>({"/BEAM0000/rx_sample_start_index"}));
+        FwdRefBeginDataset beginDataset("GEDI_L1B", "rx_sample_start_index", config.get());
+        beginDataset.writeDataset(outgroup, "/BEAM0000/", indataset, &selection, &subsetDataLayers);
+
+        H5::DataSet outdataset = outgroup.openDataSet("rx_sample_start_index");
+        std::vector<int64_t> beginOut(outdataset.getSpace().getSimpleExtentNpoints());
+        outdataset.read(beginOut.data(), H5::PredType::NATIVE_INT64);
+        return beginOut;
+    }
+
+    std::unique_ptr<Configuration> config;
+    H5::H5File file;
+    H5::Group ingroup;
+    H5::Group outgroup;
+
+    // Waveforms padded beyond their sample counts (3, 4, -, 5, 4, 3), as the
+    // GEDI rx_sample_start_index/rx_sample_count datasets are, with a fill value.
+    // The waveform of each segment runs up to the start of the next one.
+    const std::vector<int64_t> paddedBegin = {1, 5, 0, 12, 20, 26};
+};
+
+
+TEST_F(FwdRefBeginDatasetTest, writeDataset_padded_gap_starting_with_fill)
+{
+    // The waveforms written for rows 0-1 run from sample 1 up to the start
+    // of row 3 (11 samples, padding included), so row 4 begins at 12.
+    std::vector<int64_t> expected = {1, 5, 12, 18};
+    EXPECT_EQ(writeBegin(paddedBegin, {{0, 2}, {4, 2}}), expected);
+}
+
+TEST_F(FwdRefBeginDatasetTest, writeDataset_padded_gap_starting_with_segment)
+{
+    // The waveform written for row 0 runs up to the start of row 1
+    // (4 samples), so row 3 begins at 5 and row 4 at 13.
+    std::vector<int64_t> expected = {1, 5, 13};
+    EXPECT_EQ(writeBegin(paddedBegin, {{0, 1}, {3, 2}}), expected);
+}
+
+TEST_F(FwdRefBeginDatasetTest, writeDataset_fill_values_kept)
+{
+    // Fill values in and between the selected rows are copied over, and the
+    // waveforms written for rows 1-3 run up to the start of row 5.
+    std::vector<int64_t> expected = {1, 0, 8, 16};
+    EXPECT_EQ(writeBegin({0, 5, 0, 12, 0, 20, 26}, {{1, 3}, {5, 1}}), expected);
+}
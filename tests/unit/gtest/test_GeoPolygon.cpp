@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+#include "../../../subsetter/GeoPolygon.h"
+
+
+class GeoPolygonTest : public ::testing::Test
+{
+protected:
+
+    std::unique_ptr<GeoPolygon> readPolygon(const std::string& geojson)
+    {
+        std::stringstream stream(geojson);
+        property_tree::ptree root;
+        property_tree::read_json(stream, root);
+        std::unique_ptr<GeoPolygon> geoPolygon = std::make_unique<GeoPolygon>(root);
+        geoPolygon->getBbox();
+        return geoPolygon;
+    }
+};
+
+
+// A track crossing a polygon with a hole, through vertices and along edges,
+// is classified as GeoPolygon::contains classifies each point.
+TEST_F(GeoPolygonTest, track_matches_contains)
+{
+    std::unique_ptr<GeoPolygon> geoPolygon = readPolygon(
+        "{\"type\": \"Polygon\", \"coordinates\": ["
+        "[[-10, -10], [10, -10], [10, 10], [0, 5], [-10, 10], [-10, -10]],"
+        "[[-2, -2], [2, -2], [2, 2], [-2, 2], [-2, -2]]]}");
+    PolygonTrack track(geoPolygon.get());
+
+    for (double lon = -15; lon <= 15; lon += 5)
+    {
+        track.reset();
+        for (double lat = -15; lat <= 15; lat += 0.25)
+        {
+            EXPECT_EQ(track.contains(lat, lon), geoPolygon->contains(lat, lon)) << lat << ", " << lon;
+        }
+    }
+
+    track.reset();
+    EXPECT_TRUE(track.contains(-5, -5));
+    EXPECT_FALSE(track.contains(0, 0));
+    EXPECT_TRUE(track.contains(6, -5));
+    EXPECT_FALSE(track.contains(6, 0));
+    EXPECT_FALSE(track.contains(10, 10));
+    EXPECT_FALSE(track.contains(20, 20));
+}
+
+
+// A track across the Anti-Meridian shifts its longitudes as contains does.
+TEST_F(GeoPolygonTest, track_across_anti_meridian)
+{
+    std::unique_ptr<GeoPolygon> geoPolygon = readPolygon(
+        "{\"type\": \"MultiPolygon\", \"coordinates\": ["
+        "[[[170, -5], [190, -5], [190, 5], [170, 5], [170, -5]]],"
+        "[[[0, 0], [1, 0], [1, 1], [0, 1], [0, 0]]]]}");
+    PolygonTrack track(geoPolygon.get());
+
+    EXPECT_FALSE(track.contains(0, 160));
+    EXPECT_TRUE(track.contains(0, 175));
+    EXPECT_TRUE(track.contains(0, -175));
+    EXPECT_FALSE(track.contains(0, -165));
+    EXPECT_TRUE(track.contains(0.5, 0.5));
+}
+
+
+// Testing only the polygons whose envelopes may contain a point gives the
+// same result as testing the whole multi-polygon, including points on the
+// boundary of one polygon and within an overlapping one.
+TEST_F(GeoPolygonTest, contains_multi_polygon_parts)
+{
+    std::stringstream geojson;
+    geojson << "{\"type\": \"MultiPolygon\", \"coordinates\": [";
+    for (int i = 0; i < 20; i++)
+    {
+        int x = (i % 5) * 10 - 20, y = (i / 5) * 10 - 20;
+        geojson << (i? ", " : "") << "[[[" << x << ", " << y << "], [" << x + 12 << ", " << y << "], ["
+                << x + 12 << ", " << y + 6 << "], [" << x << ", " << y + 6 << "], [" << x << ", " << y << "]]]";
+    }
+    geojson << "]}";
+    std::unique_ptr<GeoPolygon> geoPolygon = readPolygon(geojson.str());
+
+    for (double lat = -25; lat <= 25; lat += 1)
+    {
+        for (double lon = -25; lon <= 40; lon += 1)
+        {
+            point_type point(lon, lat);
+            EXPECT_EQ(geoPolygon->contains(lat, lon), boost::geometry::within(point, geoPolygon->polygons)) << lat << ", " << lon;
+        }
+    }
+}
+
+
+// Reading the GeoJSON text directly finds the same polygons as reading its
+// property tree, whatever the order of the object members.
+TEST_F(GeoPolygonTest, read_geojson_text)
+{
+    std::string geojson =
+        "{\"features\": [{\"geometry\": {\"coordinates\": [[[0, 0], [4, 0], [4, 4], [0, 0]], [[1, 0.5], [2, 0.5], [2, 1], [1, 0.5]]],"
+        " \"type\": \"Polygon\"}, \"type\": \"Feature\", \"properties\": {\"type\": \"Polygon\", \"coordinates\": \"none\"}},"
+        " {\"type\": \"Feature\", \"geometry\": {\"type\": \"MultiPolygon\", \"coordinates\": [[[[10, 10], [11, 10], [11, 11], [10, 10]]],"
+        " [[[20, 20], [21, 20], [21, 21], [20, 20]]]]}}], \"type\": \"FeatureCollection\"}";
+    std::unique_ptr<GeoPolygon> expected = readPolygon(geojson);
+    GeoPolygon geoPolygon(geojson);
+
+    ASSERT_EQ(geoPolygon.polygons.size(), expected->polygons.size());
+    EXPECT_TRUE(boost::geometry::equals(geoPolygon.polygons[0], expected->polygons[0]));
+    EXPECT_EQ(geoPolygon.polygons[0].inners().size(), 1);
+    EXPECT_TRUE(boost::geometry::equals(geoPolygon.polygons[2], expected->polygons[2]));
+
+    EXPECT_THROW(GeoPolygon(std::string("")), property_tree::json_parser::json_parser_error);
+    EXPECT_THROW(GeoPolygon(std::string("{\"type\": \"Polygon\"")), property_tree::json_parser::json_parser_error);
+    EXPECT_THROW(GeoPolygon(std::string("{\"type\": \"Polygon\", \"coordinates\": [[[0, 0], [1]]]}")),
+                 property_tree::json_parser::json_parser_error);
+}
+
+
+// A bounding shape read once is read from the cache directory afterwards.
+TEST_F(GeoPolygonTest, read_geojson_cache)
+{
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "test_GeoPolygon_cache";
+    std::filesystem::remove_all(cacheDirectory);
+    std::filesystem::create_directories(cacheDirectory);
+
+    std::string geojson = "{\"type\": \"Polygon\", \"coordinates\": [[[0, 0], [4, 0], [4, 4], [0, 0]], [[1, 0.5], [2, 0.5], [2, 1], [1, 0.5]]]}";
+    GeoPolygon parsed(geojson, cacheDirectory.string());
+    ASSERT_EQ(std::distance(std::filesystem::directory_iterator(cacheDirectory), std::filesystem::directory_iterator()), 1);
+
+    GeoPolygon cached(geojson, cacheDirectory.string());
+    ASSERT_EQ(cached.polygons.size(), 1);
+    EXPECT_TRUE(boost::geometry::equals(cached.polygons[0], parsed.polygons[0]));
+    EXPECT_EQ(cached.polygons[0].inners().size(), 1);
+
+    std::filesystem::remove_all(cacheDirectory);
+}
+
+
+// A cache file of another bounding shape, as if the two shared a hash, is
+// not used, and is replaced by the cache of the shape read.
+TEST_F(GeoPolygonTest, read_geojson_cache_of_other_shape)
+{
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "test_GeoPolygon_other_cache";
+    std::filesystem::remove_all(cacheDirectory);
+    std::filesystem::create_directories(cacheDirectory);
+
+    std::string geojson = "{\"type\": \"Polygon\", \"coordinates\": [[[0, 0], [4, 0], [4, 4], [0, 0]]]}";
+    std::string other = "{\"type\": \"Polygon\", \"coordinates\": [[[0, 0], [8, 0], [8, 8], [0, 0]]]}";
+    ASSERT_EQ(geojson.size(), other.size());
+    GeoPolygon parsed(geojson, cacheDirectory.string());
+
+    // the cache file of the shape now holds the polygons of the other shape
+    std::filesystem::path cachePath = std::filesystem::directory_iterator(cacheDirectory)->path();
+    std::filesystem::path otherDirectory = cacheDirectory / "other";
+    std::filesystem::create_directories(otherDirectory);
+    GeoPolygon otherParsed(other, otherDirectory.string());
+    std::filesystem::copy_file(std::filesystem::directory_iterator(otherDirectory)->path(), cachePath,
+                               std::filesystem::copy_options::overwrite_existing);
+
+    GeoPolygon cached(geojson, cacheDirectory.string());
+    ASSERT_EQ(cached.polygons.size(), 1);
+    EXPECT_TRUE(boost::geometry::equals(cached.polygons[0], parsed.polygons[0]));
+
+    GeoPolygon recached(geojson, cacheDirectory.string());
+    ASSERT_EQ(recached.polygons.size(), 1);
+    EXPECT_TRUE(boost::geometry::equals(recached.polygons[0], parsed.polygons[0]));
+
+    std::filesystem::remove_all(cacheDirectory);
+}
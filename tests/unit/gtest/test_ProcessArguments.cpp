@@ -4,6 +4,7 @@
 #include <fstream>
 #include <string>
 #include "../../../subsetter/ProcessArguments.h"
+#include "../../../subsetter/SubsetDaemon.h"
 
 namespace
 {
@@ -196,4 +197,235 @@ namespace
         EXPECT_EQ(results, ProcessArguments::ERROR);
     }
 
+    // Test copy_file_range is only enabled when requested
+    TEST_F(test_ProcessArguments, test_process_args_copy_file_range)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--filename",  temp_file_path.string(),
+            "--outfile", "subset_fake_file.h5"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_FALSE(processArgs->isCopyFileRange());
+
+        arguments.push_back("--copyfilerange");
+        argv.clear();
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        std::shared_ptr<ProcessArguments> copyArgs = std::make_shared<ProcessArguments>();
+        results = copyArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_TRUE(copyArgs->isCopyFileRange());
+    }
+
+    // Test an estimate does not require an output file
+    TEST_F(test_ProcessArguments, test_process_args_estimate)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--filename",  temp_file_path.string()
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::ERROR);
+        EXPECT_FALSE(processArgs->isEstimate());
+
+        arguments.push_back("--estimate");
+        argv.clear();
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        std::shared_ptr<ProcessArguments> estimateArgs = std::make_shared<ProcessArguments>();
+        results = estimateArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_TRUE(estimateArgs->isEstimate());
+        EXPECT_TRUE(estimateArgs->getOutfilename().empty());
+    }
+
+    // Test the in-memory output cap is read in MB and must be positive
+    TEST_F(test_ProcessArguments, test_process_args_in_memory_output_cap)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--filename",  temp_file_path.string(),
+            "--outfile", "subset_fake_file.h5",
+            "--inmemory", "200"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_EQ(processArgs->getInMemoryOutputCapMB(), 200);
+
+        arguments.back() = "0";
+        argv.clear();
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        std::shared_ptr<ProcessArguments> invalidArgs = std::make_shared<ProcessArguments>();
+        results = invalidArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::ERROR);
+    }
+
+    // Test an input file descriptor can be given instead of a file name
+    TEST_F(test_ProcessArguments, test_process_args_input_fd)
+    {
+        FILE* temp_file = fopen(temp_file_path.string().c_str(), "r");
+        ASSERT_TRUE(temp_file != NULL);
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--inputfd", std::to_string(fileno(temp_file)),
+            "--outfile", "subset_fake_file.h5"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_EQ(processArgs->getInputFd(), fileno(temp_file));
+        EXPECT_TRUE(processArgs->isFileImage());
+        fclose(temp_file);
+
+        // The descriptor is now closed.
+        std::shared_ptr<ProcessArguments> closedArgs = std::make_shared<ProcessArguments>();
+        results = closedArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::ERROR);
+    }
+
+    // Test a daemon only needs the configuration file and socket path
+    TEST_F(test_ProcessArguments, test_process_args_daemon)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--daemon", "/tmp/subsetter.sock",
+            "--maxjobs", "4"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_EQ(processArgs->getDaemonSocket(), "/tmp/subsetter.sock");
+        EXPECT_EQ(processArgs->getMaxJobs(), 4);
+    }
+
+    // Test a batch only needs the configuration file and manifest, and the
+    // memory budget must be positive
+    TEST_F(test_ProcessArguments, test_process_args_manifest)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--manifest", "jobs.jsonl",
+            "--maxjobs", "8",
+            "--memorybudget", "4096"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        EXPECT_EQ(processArgs->getManifest(), "jobs.jsonl");
+        EXPECT_EQ(processArgs->getMaxJobs(), 8);
+        EXPECT_EQ(processArgs->getMemoryBudgetMB(), 4096);
+
+        arguments.back() = "0";
+        argv.clear();
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        std::shared_ptr<ProcessArguments> invalidArgs = std::make_shared<ProcessArguments>();
+        results = invalidArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::ERROR);
+    }
+
+    // Test named regions replace the kinds of constraints they define, keep
+    // the others of the request, and name their own outputs
+    TEST_F(test_ProcessArguments, test_process_args_regions)
+    {
+        std::vector<std::string> arguments =
+        {
+            "--configfile", "../../../harmony_service/subsetter_config.json",
+            "--filename",  temp_file_path.string(),
+            "--outfile", "subset_fake_file.h5",
+            "--bbox", "-10,40,10,50",
+            "--start", "2018-10-14T00:27:00", "--end", "2018-10-14T00:27:30",
+            "--region", "{\"name\": \"east\", \"bbox\": [\"20,40,30,50\", \"40,40,50,50\"]}",
+            "--region", "{\"name\": \"night\", \"outfile\": \"night.h5\", "
+                        "\"start\": \"2018-10-14T00:28:00\", \"end\": \"2018-10-14T00:28:30\"}"
+        };
+
+        // Build arguments string for processArgs->process_args() input
+        std::vector<char*> argv;
+        for (const auto& arg : arguments)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+
+        int results = processArgs->process_args(argv.size(), argv.data());
+        EXPECT_EQ(results, ProcessArguments::PASS);
+        ASSERT_EQ(processArgs->getRegionCount(), 2);
+
+        std::shared_ptr<ProcessArguments> east;
+        EXPECT_EQ(processArgs->getRegionArguments(0, east), ProcessArguments::PASS);
+        EXPECT_EQ(east->getOutfilename(), "subset_fake_file_east.h5");
+        ASSERT_TRUE(east->getGeoboxes() != nullptr);
+        EXPECT_EQ(east->getGeoboxes()->size(), 2);
+        EXPECT_EQ(east->getStartString(), "2018-10-14T00:27:00");
+        EXPECT_EQ(east->getRegionCount(), 0);
+
+        std::shared_ptr<ProcessArguments> night;
+        EXPECT_EQ(processArgs->getRegionArguments(1, night), ProcessArguments::PASS);
+        EXPECT_EQ(night->getOutfilename(), "night.h5");
+        ASSERT_TRUE(night->getGeoboxes() != nullptr);
+        EXPECT_EQ(night->getGeoboxes()->size(), 1);
+        EXPECT_EQ(night->getStartString(), "2018-10-14T00:28:00");
+
+        std::remove("subset_fake_file_east.h5");
+        std::remove("night.h5");
+    }
+
+    // Test a daemon request is converted into command line arguments
+    TEST_F(test_ProcessArguments, test_daemon_request_to_arguments)
+    {
+        std::vector<std::string> arguments = SubsetDaemon::requestToArguments(
+            "{\"filename\": \"in.h5\", \"bbox\": [\"-10,40,10,50\", \"20,40,30,50\"], "
+            "\"copyfilerange\": true, \"fileimage\": false}");
+
+        std::vector<std::string> expected =
+        {
+            "subset", "--filename", "in.h5", "--bbox", "-10,40,10,50", "--bbox", "20,40,30,50", "--copyfilerange"
+        };
+        EXPECT_EQ(arguments, expected);
+    }
+
 }
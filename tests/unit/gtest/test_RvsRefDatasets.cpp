@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest_utilities.h"
+
+#include "H5Cpp.h"
+#include "../../../subsetter/IndexSelection.h"
+#include "../../../subsetter/SubsetDataLayers.h"
+#include "../../../subsetter/RvsRefDatasets.h"
+
+
+class RvsRefDatasetsTest : public ::testing::Test
+{
+protected:
+    RvsRefDatasetsTest()
+    {
+        file = gtest_utilities::createInMemoryFile("rvs_ref_datasets_test.h5");
+        ingroup = file.createGroup("/freeboard_swath_segment");
+        outgroup = file.createGroup("/out");
+    }
+
+    /*
+     * @brief Remap every row of an index reference dataset to a subset of
+     *        the 20 rows of its referenced group, and return the values
+     *        written.
+     *
+     * @param references The input index references.
+     * @param targetSegments The selected rows of the referenced group, as
+     *                       (start, count) pairs.
+     */
+    std::vector<int64_t> remap(const std::vector<int64_t>& references,
+                               const std::vector<std::pair<long, long>>& targetSegments)
+    {
+        H5::DataSet indataset = gtest_utilities::writeDataset(ingroup, "fbswath_lead_ndx_gt1", references,
+                                                              H5::PredType::STD_I32LE);
+
+        IndexSelection indexes(references.size());
+        indexes.addSegment(0, references.size());
+        IndexSelection targetIndexes(20);
+        for (size_t i = 0; i < targetSegments.size(); i++)
+        {
+            targetIndexes.addSegment(targetSegments[i].first, targetSegments[i].second);
+        }
+
+        SubsetDataLayers subsetDataLayers(variables);
+        RvsRefDatasets referenceDataset("ATL10", "fbswath_lead_ndx_gt1");
+        referenceDataset.mapWriteDataset(outgroup, "/freeboard_swath_segment/", indataset,
+                                         &indexes, &targetIndexes, &subsetDataLayers);
+
+        H5::DataSet outdataset = outgroup.openDataSet("fbswath_lead_ndx_gt1");
+        std::vector<int64_t> remapped(outdataset.getSpace().getSimpleExtentNpoints());
+        outdataset.read(remapped.data(), H5::PredType::NATIVE_INT64);
+        return remapped;
+    }
+
+    std::vector<std::string> variables;
+    H5::H5File file;
+    H5::Group ingroup;
+    H5::Group outgroup;
+};
+
+
+TEST_F(RvsRefDatasetsTest, mapWriteDataset_skipped_target_segment)
+{
+    // The references skip the selected rows 6-8 of the referenced group, so
+    // rows 13-14 follow the two rows of the first segment and the three of
+    // the second in the subset.
+    std::vector<int64_t> expected = {1, 2, 6, 7};
+    EXPECT_EQ(remap({1, 2, 13, 14}, {{0, 2}, {5, 3}, {12, 4}}), expected);
+}
+
+TEST_F(RvsRefDatasetsTest, mapWriteDataset_unselected_target_rows)
+{
+    // References to rows that are not selected, or beyond the referenced
+    // group, are written as the fill value, and fill values are copied over.
+    std::vector<int64_t> expected = {1, 2, -1, 3, 5, -1, -1, 0, -1};
+    EXPECT_EQ(remap({1, 2, 3, 6, 8, 10, 21, 0, -1}, {{0, 2}, {5, 3}}), expected);
+}
+
+TEST_F(RvsRefDatasetsTest, mapWriteDataset_fill_value_attribute)
+{
+    // The dataset's own _FillValue is written for unselected rows.
+    int32_t fillValue = 0;
+    H5::DataSet references = gtest_utilities::writeDataset(ingroup, "fbswath_lead_ndx_gt1", {1, 4, 6},
+                                                           H5::PredType::STD_I32LE);
+    references.createAttribute("_FillValue", H5::PredType::NATIVE_INT, H5::DataSpace(H5S_SCALAR))
+        .write(H5::PredType::NATIVE_INT, &fillValue);
+
+    IndexSelection indexes(3);
+    indexes.addSegment(0, 3);
+    IndexSelection targetIndexes(20);
+    targetIndexes.addSegment(5, 3);
+
+    SubsetDataLayers subsetDataLayers(variables);
+    RvsRefDatasets referenceDataset("ATL10", "fbswath_lead_ndx_gt1");
+    referenceDataset.mapWriteDataset(outgroup, "/freeboard_swath_segment/", references,
+                                     &indexes, &targetIndexes, &subsetDataLayers);
+
+    std::vector<int64_t> remapped(3);
+    outgroup.openDataSet("fbswath_lead_ndx_gt1").read(remapped.data(), H5::PredType::NATIVE_INT64);
+    EXPECT_EQ(remapped, std::vector<int64_t>({0, 0, 1}));
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../../subsetter/SubsetDataLayers.h"
+
+
+class SubsetDataLayersTest : public ::testing::Test
+{
+protected:
+
+    std::vector<std::string> variables;
+};
+
+
+// All datasets are included when no variables are requested.
+TEST_F(SubsetDataLayersTest, include_all_without_variables)
+{
+    SubsetDataLayers subsetDataLayers(variables);
+
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/gt1l/heights/h_ph"));
+    EXPECT_TRUE(subsetDataLayers.is_child_included("/gt1l/"));
+
+    std::vector<std::set<std::string>> datasets = subsetDataLayers.getDatasets();
+    ASSERT_EQ(datasets.size(), 1);
+    EXPECT_EQ(datasets[0], std::set<std::string>({"/"}));
+}
+
+
+// A dataset is included when it or one of its ancestors is requested, and
+// a group is a parent of the requested datasets below it.
+TEST_F(SubsetDataLayersTest, included_and_child_included)
+{
+    variables = {"/gt1l/heights/h_ph,/gt2r/geolocation", "/ancillary_data/atlas_sdp_gps_epoch"};
+    SubsetDataLayers subsetDataLayers(variables);
+
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/gt1l/heights/h_ph"));
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/gt2r/geolocation/segment_id"));
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/METADATA/DatasetIdentification"));
+    EXPECT_FALSE(subsetDataLayers.is_dataset_included("/gt1l/heights/lat_ph"));
+    EXPECT_FALSE(subsetDataLayers.is_dataset_included("/gt1l/heights"));
+    EXPECT_FALSE(subsetDataLayers.is_dataset_included("/gt2r"));
+
+    EXPECT_TRUE(subsetDataLayers.is_child_included("/gt1l/heights"));
+    EXPECT_TRUE(subsetDataLayers.is_child_included("/gt1l/heights/h_ph"));
+    EXPECT_TRUE(subsetDataLayers.is_child_included("/gt2r/"));
+    EXPECT_FALSE(subsetDataLayers.is_child_included("/gt1l/geolocation"));
+    EXPECT_FALSE(subsetDataLayers.is_child_included("/gt1"));
+    EXPECT_FALSE(subsetDataLayers.is_child_included("/gt2r/geolocation/segment_id"));
+
+    EXPECT_TRUE(subsetDataLayers.is_included("/gt1l"));
+    EXPECT_TRUE(subsetDataLayers.is_included("/gt2r/geolocation/segment_id"));
+    EXPECT_FALSE(subsetDataLayers.is_included("/gt3l"));
+}
+
+
+// Requesting a group purges the datasets below it that were already
+// requested, and datasets below a requested group are not added.
+TEST_F(SubsetDataLayersTest, ancestor_purges_descendants)
+{
+    variables = {"/gt1l/heights/h_ph", "/gt1l/heights/lat_ph", "/gt1l/", "/gt1l/geolocation/segment_id", "/gt2l/heights"};
+    SubsetDataLayers subsetDataLayers(variables);
+
+    std::vector<std::set<std::string>> datasets = subsetDataLayers.getDatasets();
+    ASSERT_EQ(datasets.size(), 4);
+    EXPECT_TRUE(datasets[0].empty());
+    EXPECT_EQ(datasets[1], std::set<std::string>({"/METADATA/", "/Metadata/", "/gt1l/"}));
+    EXPECT_EQ(datasets[2], std::set<std::string>({"/gt2l/heights/"}));
+    EXPECT_TRUE(datasets[3].empty());
+
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/gt1l/heights/h_ph"));
+    EXPECT_TRUE(subsetDataLayers.is_dataset_included("/gt1l/bckgrd_atlas/delta_time"));
+    EXPECT_TRUE(subsetDataLayers.is_child_included("/gt2l"));
+    EXPECT_FALSE(subsetDataLayers.is_dataset_included("/gt2l/geolocation"));
+}
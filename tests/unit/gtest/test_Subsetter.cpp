@@ -3,14 +3,26 @@
 *
 *   Function tests included:
 *   - addGroupsRequiringTemporalSubsetting
+*   - isMatchingDataFound
+*   - copyContiguousSegments
+*   - writeEstimate
+*   - findPossibleMatch
+*   - isOutsideGranuleExtent
+*   - requiresTemporalSubsetting
 *
 */
 
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <string.h>
+#include <vector>
 
 #include <boost/program_options/parsers.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
 
 #include "gtest_utilities.h"
 
@@ -19,6 +31,7 @@
 #include "../../../subsetter/geobox.h"
 #include "../../../subsetter/SubsetDataLayers.h"
 #include "../../../subsetter/Subsetter.h"
+#include "../../../subsetter/IcesatSubsetter.h"
 
 
 class StubSubsetter : public Subsetter
@@ -56,6 +69,8 @@ public:
         return coor.get();
     }
 
+    using Subsetter::isOutsideGranuleExtent;
+
 private:
     std::vector<std::string> groupsWithOnlyTemporalCoordinates;
     std::vector<std::string> requestedVariables;
@@ -355,3 +370,438 @@ TEST_F(SubsetterTest, test_isMatchingDataFound_outfilename_getNumObj_greater_zer
     bool expected = subsetter->isMatchingDataFound(infilename, outfilename);
     EXPECT_TRUE(expected);
 }
+
+
+class SubsetterGranuleTest : public ::testing::Test
+{
+protected:
+
+    SubsetterGranuleTest()
+    {
+        std::string config_file_path = gtest_utilities::getFullPath("harmony_service/subsetter_config.json");
+        config = std::make_unique<Configuration>(config_file_path);
+        subsetDataLayers = std::make_unique<SubsetDataLayers>(variables);
+
+        // Tests may run in parallel, each in a directory of its own.
+        directory = std::filesystem::temp_directory_path() /
+                    (std::string("test_Subsetter_") + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+
+    ~SubsetterGranuleTest()
+    {
+        std::filesystem::remove_all(directory);
+        Coordinate::resetLookUp();
+    }
+
+    std::string getPath(const std::string& name)
+    {
+        return (directory / name).string();
+    }
+
+    /*
+     * @brief Copy the ATL03 test granule, without the processing parameters
+     *        of the subset that produced it, which the subset adds again.
+     *
+     * @param name The name of the copy in the test directory.
+     * @return The path of the copy.
+     */
+    std::string copyInput(const std::string& name)
+    {
+        std::string path = getPath(name);
+        std::filesystem::copy_file(gtest_utilities::getFullPath("tests/data/ATL03_gt1l.h5"), path);
+        H5::H5File file(path, H5F_ACC_RDWR);
+        file.removeAttr("Processing Parameters");
+        return path;
+    }
+
+    /*
+     * @brief Rewrite the ATL03 test granule with its datasets of fixed size
+     *        types in the contiguous layout, without dimension scales.
+     *
+     * @param name The name of the copy in the test directory.
+     * @return The path of the copy.
+     */
+    std::string writeContiguousInput(const std::string& name)
+    {
+        std::string path = getPath(name);
+        H5::H5File input(gtest_utilities::getFullPath("tests/data/ATL03_gt1l.h5"), H5F_ACC_RDONLY);
+        H5::H5File output(path, H5F_ACC_TRUNC);
+        H5::Group inputRoot = input.openGroup("/");
+        H5::Group outputRoot = output.openGroup("/");
+        writeContiguousGroup(inputRoot, outputRoot);
+        outputRoot.removeAttr("Processing Parameters");
+        return path;
+    }
+
+    static void copyAttributes(H5::H5Object& input, H5::H5Object& output)
+    {
+        for (int i = 0; i < input.getNumAttrs(); i++)
+        {
+            H5::Attribute attribute = input.openAttribute(i);
+            std::string name = attribute.getName();
+            if (name == "DIMENSION_LIST" || name == "REFERENCE_LIST" || name == "CLASS" || name == "NAME")
+                continue;
+
+            H5::DataType datatype = attribute.getDataType();
+            H5::DataSpace space = attribute.getSpace();
+            std::vector<char> buffer(space.getSimpleExtentNpoints() * datatype.getSize());
+            attribute.read(datatype, buffer.data());
+            output.createAttribute(name, datatype, space).write(datatype, buffer.data());
+        }
+    }
+
+    static void writeContiguousGroup(H5::Group& input, H5::Group& output)
+    {
+        copyAttributes(input, output);
+        for (hsize_t i = 0; i < input.getNumObjs(); i++)
+        {
+            std::string name = input.getObjnameByIdx(i);
+            if (input.childObjType(name) == H5O_TYPE_GROUP)
+            {
+                H5::Group inputGroup = input.openGroup(name);
+                H5::Group outputGroup = output.createGroup(name);
+                writeContiguousGroup(inputGroup, outputGroup);
+            }
+            else if (input.childObjType(name) == H5O_TYPE_DATASET)
+            {
+                H5::DataSet inputDataset = input.openDataSet(name);
+                H5::DataType datatype = inputDataset.getDataType();
+                H5::DataSpace space = inputDataset.getSpace();
+                H5T_class_t typeClass = datatype.getClass();
+                bool variableSize = typeClass == H5T_VLEN || typeClass == H5T_REFERENCE ||
+                                    (typeClass == H5T_STRING && H5Tis_variable_str(datatype.getId()) > 0);
+
+                H5::DSetCreatPropList plist = inputDataset.getCreatePlist();
+                if (!variableSize && space.getSimpleExtentNdims() > 0)
+                {
+                    std::vector<hsize_t> dims(space.getSimpleExtentNdims());
+                    space.getSimpleExtentDims(dims.data());
+                    space = H5::DataSpace(dims.size(), dims.data());
+                    plist = H5::DSetCreatPropList();
+                    plist.setLayout(H5D_CONTIGUOUS);
+                }
+
+                H5::DataSet outputDataset = output.createDataSet(name, datatype, space, plist);
+                if (typeClass != H5T_REFERENCE)
+                {
+                    std::vector<char> buffer(space.getSimpleExtentNpoints() * datatype.getSize());
+                    inputDataset.read(buffer.data(), datatype);
+                    outputDataset.write(buffer.data(), datatype);
+                }
+                copyAttributes(inputDataset, outputDataset);
+            }
+        }
+    }
+
+    /*
+     * @brief Read the bytes of the datasets of fixed size types in a group,
+     *        recursively, by dataset name.
+     */
+    static void readDatasets(H5::Group& group, const std::string& groupname,
+                             std::map<std::string, std::vector<char>>& datasets)
+    {
+        for (hsize_t i = 0; i < group.getNumObjs(); i++)
+        {
+            std::string name = group.getObjnameByIdx(i);
+            if (group.childObjType(name) == H5O_TYPE_GROUP)
+            {
+                H5::Group subgroup = group.openGroup(name);
+                readDatasets(subgroup, groupname + name + "/", datasets);
+            }
+            else if (group.childObjType(name) == H5O_TYPE_DATASET)
+            {
+                H5::DataSet dataset = group.openDataSet(name);
+                H5::DataType datatype = dataset.getDataType();
+                if (H5Tdetect_class(datatype.getId(), H5T_VLEN) > 0 || H5Tdetect_class(datatype.getId(), H5T_REFERENCE) > 0 ||
+                    (datatype.getClass() == H5T_STRING && H5Tis_variable_str(datatype.getId()) > 0))
+                    continue;
+
+                std::vector<char> buffer(dataset.getSpace().getSimpleExtentNpoints() * datatype.getSize());
+                dataset.read(buffer.data(), datatype);
+                datasets[groupname + name] = buffer;
+            }
+        }
+    }
+
+    /*
+     * @brief Subset a granule with an ICESat-2 subsetter, as Subset.cpp does
+     *        for a request without regions, or only estimate the subset.
+     */
+    int subset(const std::string& infilename, const std::string& outfilename, bool copyFileRange = false,
+               bool estimate = false)
+    {
+        Coordinate::resetLookUp();
+        IcesatSubsetter subsetter(subsetDataLayers.get(), geoboxes.get(), temporal.get(), nullptr, config.get());
+        subsetter.setCopyFileRange(copyFileRange);
+        subsetter.setEstimate(estimate);
+        return subsetter.subset(infilename, outfilename, "ATL03");
+    }
+
+    /*
+     * @brief Check the constraints against the extent in the metadata of the
+     *        ATL03 test granule, for a granule of the given short name.
+     */
+    bool isOutsideGranuleExtent(std::string shortName)
+    {
+        H5::H5File input(gtest_utilities::getFullPath("tests/data/ATL03_gt1l.h5"), H5F_ACC_RDONLY);
+        StubSubsetter subsetter(subsetDataLayers.get(), geoboxes.get(), temporal.get(), nullptr, config.get(),
+                                shortName, input, std::vector<std::string>(), variables);
+        return subsetter.isOutsideGranuleExtent();
+    }
+
+    /*
+     * @brief Read the values of a dataset of a granule.
+     */
+    static std::vector<double> readValues(const std::string& filename, const std::string& datasetName)
+    {
+        H5::DataSet dataset = H5::H5File(filename, H5F_ACC_RDONLY).openDataSet(datasetName);
+        std::vector<double> values(dataset.getSpace().getSimpleExtentNpoints());
+        dataset.read(values.data(), H5::PredType::NATIVE_DOUBLE);
+        return values;
+    }
+
+    /*
+     * @brief Read a bound of the extent of the ATL03 test granule.
+     */
+    static double readExtent(const std::string& name)
+    {
+        H5::H5File input(gtest_utilities::getFullPath("tests/data/ATL03_gt1l.h5"), H5F_ACC_RDONLY);
+        double value;
+        input.openGroup("/METADATA/Extent").openAttribute(name).read(H5::PredType::NATIVE_DOUBLE, &value);
+        return value;
+    }
+
+    std::filesystem::path directory;
+
+    std::unique_ptr<Configuration> config = nullptr;
+    std::unique_ptr<std::vector<geobox>> geoboxes = nullptr;
+    std::unique_ptr<Temporal> temporal = nullptr;
+    std::unique_ptr<SubsetDataLayers> subsetDataLayers = nullptr;
+
+    std::vector<std::string> variables;
+};
+
+
+TEST_F(SubsetterGranuleTest, copyContiguousSegments_multiple_segments)
+{
+    // Two bounding boxes select several segments of the photons. The
+    // contiguous datasets copied with copy_file_range keep their layout, and
+    // hold the same bytes as the buffered copy.
+    geoboxes = std::make_unique<std::vector<geobox>>();
+    geoboxes->push_back(geobox(-179, 87.2950, 0, 87.2975));
+    geoboxes->push_back(geobox(0, 87.2960, 179, 87.2985));
+    std::string input = writeContiguousInput("contiguous.h5");
+
+    ASSERT_EQ(subset(input, getPath("copy_file_range.h5"), true), 0);
+    ASSERT_EQ(subset(input, getPath("buffered.h5"), false), 0);
+
+    H5::H5File copyFileRangeOutput(getPath("copy_file_range.h5"), H5F_ACC_RDONLY);
+    H5::H5File bufferedOutput(getPath("buffered.h5"), H5F_ACC_RDONLY);
+    H5::DataSet copied = copyFileRangeOutput.openDataSet("/gt1l/heights/lat_ph");
+    H5::DataSet buffered = bufferedOutput.openDataSet("/gt1l/heights/lat_ph");
+    EXPECT_EQ(copied.getCreatePlist().getLayout(), H5D_CONTIGUOUS);
+    EXPECT_EQ(buffered.getCreatePlist().getLayout(), H5D_CHUNKED);
+
+    // The selection is made of several segments of the input photons.
+    H5::DataSet inputDataset = H5::H5File(input, H5F_ACC_RDONLY).openDataSet("/gt1l/heights/lat_ph");
+    std::vector<double> inputLatitudes(inputDataset.getSpace().getSimpleExtentNpoints());
+    std::vector<double> latitudes(copied.getSpace().getSimpleExtentNpoints());
+    inputDataset.read(inputLatitudes.data(), H5::PredType::NATIVE_DOUBLE);
+    copied.read(latitudes.data(), H5::PredType::NATIVE_DOUBLE);
+    ASSERT_FALSE(latitudes.empty());
+    size_t start = std::find(inputLatitudes.begin(), inputLatitudes.end(), latitudes[0]) - inputLatitudes.begin();
+    EXPECT_FALSE(start + latitudes.size() <= inputLatitudes.size() &&
+                 std::equal(latitudes.begin(), latitudes.end(), inputLatitudes.begin() + start));
+
+    std::map<std::string, std::vector<char>> copyFileRangeDatasets, bufferedDatasets;
+    H5::Group copyFileRangeRoot = copyFileRangeOutput.openGroup("/");
+    H5::Group bufferedRoot = bufferedOutput.openGroup("/");
+    readDatasets(copyFileRangeRoot, "/", copyFileRangeDatasets);
+    readDatasets(bufferedRoot, "/", bufferedDatasets);
+    EXPECT_FALSE(copyFileRangeDatasets.empty());
+    EXPECT_EQ(copyFileRangeDatasets, bufferedDatasets);
+}
+
+
+TEST_F(SubsetterGranuleTest, writeEstimate_ATL03_bbox)
+{
+    // The estimate holds the index selection of each group, including the
+    // groups subset by the time range of the others, and the rows and bytes
+    // of each dataset the subset writes.
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-179, 87.2955, 179, 87.297));
+    std::string input = copyInput("ATL03_gt1l.h5");
+
+    ASSERT_EQ(subset(input, getPath("estimate.json"), false, true), 0);
+    boost::property_tree::ptree estimate;
+    boost::property_tree::read_json(getPath("estimate.json"), estimate);
+
+    std::map<std::string, std::vector<long>> groups;
+    for (boost::property_tree::ptree::value_type& group : estimate.get_child("groups"))
+    {
+        groups[group.second.get<std::string>("name")] = {group.second.get<long>("selectedRows"),
+                                                         group.second.get<long>("totalRows"),
+                                                         group.second.get<long>("segments")};
+    }
+    std::map<std::string, std::vector<long>> expectedGroups = {
+        {"/gt1l/geolocation/", {12, 40, 1}},
+        {"/gt1l/geophys_corr/", {12, 40, 1}},
+        {"/gt1l/heights/", {819, 2909, 1}},
+        {"/gt1l/bckgrd_atlas/", {7, 11378, 1}},
+        {"/gt1l/signal_find_output/ocean/", {5, 8659, 1}}
+    };
+    EXPECT_EQ(groups, expectedGroups);
+
+    // The projected size matches the subset written with the same constraints.
+    ASSERT_EQ(subset(input, getPath("subset.h5")), 0);
+    H5::H5File output(getPath("subset.h5"), H5F_ACC_RDONLY);
+    hsize_t totalBytes = 0;
+    for (boost::property_tree::ptree::value_type& dataset : estimate.get_child("datasets"))
+    {
+        std::string name = dataset.second.get<std::string>("name");
+        hsize_t rows = dataset.second.get<hsize_t>("rows");
+        hsize_t bytes = dataset.second.get<hsize_t>("bytes");
+        totalBytes += bytes;
+        if (bytes == 0)
+        {
+            EXPECT_FALSE(output.nameExists(name)) << name;
+            continue;
+        }
+
+        ASSERT_TRUE(output.nameExists(name)) << name;
+        H5::DataSet outputDataset = output.openDataSet(name);
+        H5::DataSpace space = outputDataset.getSpace();
+        std::vector<hsize_t> dims(std::max(space.getSimpleExtentNdims(), 1), 1);
+        space.getSimpleExtentDims(dims.data());
+        EXPECT_EQ(rows, dims[0]) << name;
+        EXPECT_EQ(bytes, space.getSimpleExtentNpoints() * outputDataset.getDataType().getSize()) << name;
+    }
+    EXPECT_EQ(estimate.get<hsize_t>("totalBytes"), totalBytes);
+
+    H5::DataSet latitudes = output.openDataSet("/gt1l/heights/lat_ph");
+    EXPECT_EQ(latitudes.getSpace().getSimpleExtentNpoints(), 819);
+}
+
+
+TEST_F(SubsetterGranuleTest, findPossibleMatch_ATL03_bbox_without_data)
+{
+    // A bounding box within the extent of the granule, away from its track,
+    // selects no data. No output is written, and the output file name,
+    // checked by creating an empty file, is removed.
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(100, 81, 101, 82));
+    std::string input = copyInput("ATL03_gt1l.h5");
+    std::string output = getPath("subset.h5");
+    std::ofstream(output.c_str()).close();
+    ASSERT_TRUE(std::filesystem::exists(output));
+
+    EXPECT_EQ(subset(input, output), 3);
+    EXPECT_FALSE(std::filesystem::exists(output));
+}
+
+
+TEST_F(SubsetterGranuleTest, isOutsideGranuleExtent_ATL03_bbox)
+{
+    // The granule extent, from 79.99 to 88.04 degrees north, crosses the
+    // Anti-Meridian from 57.61 east to 143.46 west.
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-179, 87.2955, 179, 87.297));
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(0, 0, 1, 1));
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-100, 82, -90, 83));
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(170, 82, -170, 83));
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+
+    // One of the bounding boxes overlapping the extent is enough.
+    geoboxes->push_back(geobox(0, 0, 1, 1));
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+}
+
+
+TEST_F(SubsetterGranuleTest, isOutsideGranuleExtent_ATL03_tolerance)
+{
+    // Bounding boxes within 0.001 degrees of the granule extent are not
+    // rejected, as the extent in the metadata may be rounded.
+    double south = readExtent("southBoundLatitude");
+    double east = readExtent("eastBoundLongitude");
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(100, south - 1, 101, south - 0.0005));
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(100, south - 1, 101, south - 0.002));
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(east + 0.0005, 82, -100, 83));
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(east + 0.002, 82, -100, 83));
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+}
+
+
+TEST_F(SubsetterGranuleTest, isOutsideGranuleExtent_ATL03_temporal)
+{
+    // The granule covers 2018-10-14T00:24:44 to 2018-10-14T00:29:54.
+    temporal = std::make_unique<Temporal>("2018-10-14T00:27:00", "2018-10-14T00:35:00");
+    EXPECT_FALSE(isOutsideGranuleExtent("ATL03"));
+
+    temporal = std::make_unique<Temporal>("2018-10-14T00:30:00", "2018-10-14T00:35:00");
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+}
+
+
+TEST_F(SubsetterGranuleTest, isOutsideGranuleExtent_without_extent_sources)
+{
+    // Products without "ExtentSources" in the configuration are never
+    // rejected from their extent.
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(0, 0, 1, 1));
+    EXPECT_TRUE(isOutsideGranuleExtent("ATL03"));
+    EXPECT_FALSE(isOutsideGranuleExtent("GLAH06"));
+}
+
+
+TEST_F(SubsetterGranuleTest, requiresTemporalSubsetting_ATL03_bbox_only)
+{
+    // The groups with only temporal coordinates are deferred in a request
+    // with only spatial constraints, and written within the time range of
+    // the spatially subset photons and segments.
+    geoboxes = std::make_unique<std::vector<geobox>>(1, geobox(-179, 87.2955, 179, 87.297));
+    std::string input = copyInput("ATL03_gt1l.h5");
+    std::string output = getPath("subset.h5");
+    ASSERT_EQ(subset(input, output), 0);
+
+    std::vector<double> times = readValues(output, "/gt1l/heights/delta_time");
+    std::vector<double> segmentTimes = readValues(output, "/gt1l/geolocation/delta_time");
+    times.insert(times.end(), segmentTimes.begin(), segmentTimes.end());
+    ASSERT_FALSE(times.empty());
+    double start = *std::min_element(times.begin(), times.end());
+    double end = *std::max_element(times.begin(), times.end());
+
+    std::map<std::string, size_t> expectedRows = {
+        {"/gt1l/bckgrd_atlas/delta_time", 7},
+        {"/gt1l/signal_find_output/ocean/delta_time", 5}
+    };
+    for (std::map<std::string, size_t>::iterator it = expectedRows.begin(); it != expectedRows.end(); it++)
+    {
+        std::vector<double> deferredTimes = readValues(output, it->first);
+        EXPECT_EQ(deferredTimes.size(), it->second) << it->first;
+        for (size_t i = 0; i < deferredTimes.size(); i++)
+        {
+            EXPECT_GE(deferredTimes[i], start) << it->first;
+            EXPECT_LE(deferredTimes[i], end) << it->first;
+        }
+
+        // The deferred groups keep their attributes.
+        std::string groupname = it->first.substr(0, it->first.find_last_of('/'));
+        EXPECT_EQ(H5::H5File(output, H5F_ACC_RDONLY).openGroup(groupname).getNumAttrs(),
+                  H5::H5File(input, H5F_ACC_RDONLY).openGroup(groupname).getNumAttrs()) << groupname;
+    }
+
+    // The other datasets of a deferred group share the index selection of
+    // its time coordinate.
+    EXPECT_EQ(readValues(output, "/gt1l/bckgrd_atlas/bckgrd_rate").size(), 7);
+}